@@ -23,6 +23,7 @@
 #include "configuredlg.h"
 #include "filetab.h"
 #include "hp4284tab.h"
+#include "frequencytab.h"
 
 #include <QTabWidget>
 #include <QDialogButtonBox>
@@ -34,15 +35,18 @@
 ConfigureDlg::ConfigureDlg(int iConfiguration, QWidget *parent)
     : QDialog(parent)
     , pTab4284(nullptr)
+    , pTabFrequency(nullptr)
     , pTabFile(nullptr)
     , pParent(parent)
     , configurationType(iConfiguration)
 {
     pTabWidget   = new QTabWidget();
-    pTab4284     = new hp4284Tab(this);
-    pTabFile     = new FileTab(configurationType, this);
-    i4284Index   = pTabWidget->addTab(pTab4284,  tr("Hp4284a"));
-    iFileIndex   = pTabWidget->addTab(pTabFile,  tr("Out File"));
+    pTab4284        = new hp4284Tab(this);
+    pTabFrequency   = new FrequencyTab(this);
+    pTabFile        = new FileTab(configurationType, this);
+    i4284Index      = pTabWidget->addTab(pTab4284,      tr("Hp4284a"));
+    iFrequencyIndex = pTabWidget->addTab(pTabFrequency, tr("Frequencies"));
+    iFileIndex      = pTabWidget->addTab(pTabFile,      tr("Out File"));
 
     pButtonBox = new QDialogButtonBox(QDialogButtonBox::Ok |
                                       QDialogButtonBox::Cancel);
@@ -70,8 +74,9 @@ ConfigureDlg::connectSignals() {
 
 void
 ConfigureDlg::onCancel() {
-    if(pTab4284) pTab4284->restoreSettings();
-    if(pTabFile) pTabFile->restoreSettings();
+    if(pTab4284)      pTab4284->restoreSettings();
+    if(pTabFrequency) pTabFrequency->restoreSettings();
+    if(pTabFile)      pTabFile->restoreSettings();
     reject();
 }
 
@@ -81,8 +86,17 @@ ConfigureDlg::onOk() {
     if(!pTabFile->checkFileName()) {
         return;
     }
+    if(!pTabFrequency->checkFrequencies()) {
+        pTabWidget->setCurrentIndex(iFrequencyIndex);
+        return;
+    }
+    if(pTab4284 && !pTab4284->checkValues()) {
+        pTabWidget->setCurrentIndex(i4284Index);
+        return;
+    }
     pTabFile->saveSettings();
     if(pTab4284) pTab4284->saveSettings();
+    pTabFrequency->saveSettings();
     pTabWidget->setCurrentIndex(i4284Index);
     accept();
 }
@@ -92,5 +106,7 @@ void
 ConfigureDlg::setToolTips() {
     if(pTabFile)
         pTabWidget->setTabToolTip(iFileIndex, QString("Output File configuration"));
+    if(pTabFrequency)
+        pTabWidget->setTabToolTip(iFrequencyIndex, QString("Measure Frequencies configuration"));
 }
 
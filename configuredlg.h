@@ -34,6 +34,7 @@
 #include <QDialogButtonBox>
 #include "filetab.h"
 #include "hp4284tab.h"
+#include "frequencytab.h"
 
 
 QT_FORWARD_DECLARE_CLASS(QGridLayout)
@@ -46,8 +47,9 @@ public:
     ConfigureDlg(int iConfiguration, QWidget *parent);
 
 public:
-    hp4284Tab* pTab4284;
-    FileTab*   pTabFile;
+    hp4284Tab*    pTab4284;
+    FrequencyTab* pTabFrequency;
+    FileTab*      pTabFile;
 
 signals:
 
@@ -65,6 +67,7 @@ private:
     QDialogButtonBox* pButtonBox;
 
     int i4284Index;
+    int iFrequencyIndex;
     int iFileIndex;
     int configurationType;
 };
@@ -0,0 +1,387 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "controlserver.h"
+
+#include <QJsonDocument>
+#include <QJsonValue>
+#include <QJsonArray>
+
+
+// Reads the numeric field sKey (if present) checking its range
+static bool
+readNumber(const QJsonObject& request, QString sKey, double min, double max,
+           double* pValue, QString* pErrorString)
+{
+    if(!request.contains(sKey))
+        return true;
+    QJsonValue value = request.value(sKey);
+    if(!value.isDouble() || (value.toDouble() < min) || (value.toDouble() > max)) {
+        *pErrorString = QString("Invalid %1 [%2 - %3]").arg(sKey).arg(min).arg(max);
+        return false;
+    }
+    *pValue = value.toDouble();
+    return true;
+}
+
+
+ControlServer::ControlServer(SessionManager* pSessionManager, QObject *parent)
+    : QObject(parent)
+    , pSessions(pSessionManager)
+{
+    // Only the user running the application can connect
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&server, SIGNAL(newConnection()),
+            this, SLOT(onNewConnection()));
+    for(int i=0; i<pSessions->count(); i++)
+        onMeterAdded(i);
+    connect(pSessions, SIGNAL(meterAdded(int)),
+            this, SLOT(onMeterAdded(int)));
+}
+
+
+ControlServer::~ControlServer() {
+    server.close();
+}
+
+
+// Stops listening, drops the clients and the connections to the
+// sessions: afterwards the SessionManager can be deleted even if this
+// object is still waiting for its deleteLater().
+void
+ControlServer::close() {
+    server.close();
+    subscribers.clear();
+    QList<QLocalSocket*> sockets = server.findChildren<QLocalSocket*>();
+    for(int i=0; i<sockets.count(); i++) {
+        disconnect(sockets.at(i), nullptr, this, nullptr);
+        sockets.at(i)->abort();
+    }
+    disconnect(pSessions, nullptr, this, nullptr);
+    for(int i=0; i<pSessions->count(); i++)
+        disconnect(pSessions->sweep(i), nullptr, this, nullptr);
+}
+
+
+// A stale socket left by a crashed session is removed, but not the
+// one of a running instance: it would lose its control channel.
+bool
+ControlServer::listen(QString sName, QString* pErrorString) {
+    QLocalSocket probe;
+    probe.connectToServer(sName);
+    if(probe.waitForConnected(1000)) {
+        probe.abort();
+        if(pErrorString) *pErrorString = QString("%1 already in use by another instance").arg(sName);
+        return false;
+    }
+    QLocalServer::removeServer(sName);
+    if(!server.listen(sName)) {
+        if(pErrorString) *pErrorString = server.errorString();
+        return false;
+    }
+    return true;
+}
+
+
+// The parameters used until changed by a "configure" command
+void
+ControlServer::setConfig(int iMeter, const SweepConfig& newConfig) {
+    configs[iMeter] = newConfig;
+}
+
+
+void
+ControlServer::onMeterAdded(int iMeter) {
+    while(configs.count() <= iMeter)
+        configs.append(Sweep::defaultConfig());
+    Sweep* pSweep = pSessions->sweep(iMeter);
+    connect(pSweep, SIGNAL(newPoints(QVector<RunRecord>)),
+            this, SLOT(onNewPoints(QVector<RunRecord>)));
+    connect(pSweep, SIGNAL(finished(bool)),
+            this, SLOT(onSweepFinished(bool)));
+    connect(pSweep, SIGNAL(stopped()),
+            this, SLOT(onSweepStopped()));
+}
+
+
+// The meter named in the request: the first one if not given,
+// -1 if unknown.
+int
+ControlServer::meterIndex(const QJsonObject& request) {
+    if(!request.contains("meter"))
+        return pSessions->count() > 0 ? 0 : -1;
+    QJsonValue meter = request.value("meter");
+    if(meter.isDouble()) {
+        int i = meter.toInt(-1);
+        return (i >= 0 && i < pSessions->count()) ? i : -1;
+    }
+    return pSessions->indexOf(meter.toString());
+}
+
+
+// The meter of the Sweep that emitted the signal
+int
+ControlServer::senderIndex() {
+    for(int i=0; i<pSessions->count(); i++) {
+        if(pSessions->sweep(i) == sender())
+            return i;
+    }
+    return -1;
+}
+
+
+void
+ControlServer::onNewConnection() {
+    while(server.hasPendingConnections()) {
+        QLocalSocket* pSocket = server.nextPendingConnection();
+        connect(pSocket, SIGNAL(readyRead()),
+                this, SLOT(onReadyRead()));
+        connect(pSocket, SIGNAL(disconnected()),
+                this, SLOT(onDisconnected()));
+    }
+}
+
+
+void
+ControlServer::onDisconnected() {
+    QLocalSocket* pSocket = qobject_cast<QLocalSocket*>(sender());
+    if(!pSocket)
+        return;
+    subscribers.removeAll(pSocket);
+    pSocket->deleteLater();
+}
+
+
+void
+ControlServer::onReadyRead() {
+    QLocalSocket* pSocket = qobject_cast<QLocalSocket*>(sender());
+    if(!pSocket)
+        return;
+    while(pSocket->canReadLine()) {
+        QByteArray line = pSocket->readLine().trimmed();
+        if(line.isEmpty())
+            continue;
+        QJsonParseError parseError;
+        QJsonDocument request = QJsonDocument::fromJson(line, &parseError);
+        QJsonObject answer;
+        if(!request.isObject()) {
+            answer.insert("ok", false);
+            answer.insert("error", QString("Invalid request: %1").arg(parseError.errorString()));
+        }
+        else {
+            answer = execute(pSocket, request.object());
+        }
+        send(pSocket, answer);
+    }
+}
+
+
+QJsonObject
+ControlServer::execute(QLocalSocket* pSocket, const QJsonObject& request) {
+    QJsonObject answer;
+    QString sCommand = request.value("cmd").toString();
+    QString sError;
+    if(sCommand == "meters") {
+        QJsonArray meters;
+        for(int i=0; i<pSessions->count(); i++) {
+            QJsonObject meter;
+            meter.insert("meter", pSessions->name(i));
+            meter.insert("running", pSessions->sweep(i)->isRunning());
+            meters.append(meter);
+        }
+        answer.insert("meters", meters);
+        answer.insert("ok", true);
+        return answer;
+    }
+    else if(sCommand == "subscribe") {
+        if(!subscribers.contains(pSocket))
+            subscribers.append(pSocket);
+        answer.insert("ok", true);
+        return answer;
+    }
+    else if(sCommand == "quit") {
+        // Emitted after the answer has been sent: the receivers
+        // could delete this object and its sockets
+        QMetaObject::invokeMethod(this, "quitRequested", Qt::QueuedConnection);
+        answer.insert("ok", true);
+        return answer;
+    }
+
+    // The commands for a single meter
+    int iMeter = meterIndex(request);
+    if(iMeter < 0) {
+        answer.insert("ok", false);
+        answer.insert("error", QString("Unknown meter"));
+        return answer;
+    }
+    Sweep* pSweep = pSessions->sweep(iMeter);
+    answer.insert("meter", pSessions->name(iMeter));
+    if(sCommand == "configure") {
+        QJsonObject result = configure(iMeter, request);
+        result.insert("meter", pSessions->name(iMeter));
+        return result;
+    }
+    else if(sCommand == "start") {
+        if(!pSweep->start(configs.at(iMeter), &sError)) {
+            answer.insert("ok", false);
+            answer.insert("error", sError);
+            return answer;
+        }
+    }
+    else if(sCommand == "resume") {
+        if(pSweep->interruptedRun().isEmpty() || !pSweep->resume(&sError)) {
+            answer.insert("ok", false);
+            answer.insert("error", sError.isEmpty() ? QString("No interrupted measure") : sError);
+            return answer;
+        }
+    }
+    else if(sCommand == "stop") {
+        pSweep->stop();
+    }
+    else if(sCommand == "status") {
+        answer.insert("running", pSweep->isRunning());
+        answer.insert("measured", pSweep->measuredCount());
+        answer.insert("pending", pSweep->pendingCount());
+        answer.insert("output", pSweep->currentConfig().sOutputFile);
+    }
+    else {
+        answer.insert("ok", false);
+        answer.insert("error", QString("Unknown command: %1").arg(sCommand));
+        return answer;
+    }
+    answer.insert("ok", true);
+    return answer;
+}
+
+
+// The fields not given keep their previous values
+QJsonObject
+ControlServer::configure(int iMeter, const QJsonObject& request) {
+    QJsonObject answer;
+    SweepConfig newConfig = configs.at(iMeter);
+    double averages        = newConfig.averages;
+    double pointsPerDecade = newConfig.pointsPerDecade;
+    double extraPoints     = newConfig.extraPoints;
+    QString sError;
+    bool bOk = readNumber(request, "area",            1.0e-3, 1.0e6,  &newConfig.area, &sError)            &&
+               readNumber(request, "thickness",       1.0e-6, 1.0e3,  &newConfig.thickness, &sError)       &&
+               readNumber(request, "voltage",         0.1,    2.0,    &newConfig.testVoltage, &sError)     &&
+               readNumber(request, "averages",        1.0,    64.0,   &averages, &sError)                  &&
+               readNumber(request, "settling",        0.0,    1000.0, &newConfig.settlingPeriods, &sError) &&
+               readNumber(request, "fmin",            20.0,   1.0e6,  &newConfig.fMin, &sError)            &&
+               readNumber(request, "fmax",            20.0,   1.0e6,  &newConfig.fMax, &sError)            &&
+               readNumber(request, "pointsPerDecade", 1.0,    100.0,  &pointsPerDecade, &sError)           &&
+               readNumber(request, "extraPoints",     0.0,    500.0,  &extraPoints, &sError)               &&
+               readNumber(request, "threshold",       0.0,    10.0,   &newConfig.threshold, &sError);
+    if(bOk && request.contains("plan")) {
+        newConfig.planMode = FrequencyPlan::modeFromName(request.value("plan").toString());
+        if(newConfig.planMode < 0) {
+            sError = QString("Invalid plan [log, file, adaptive]");
+            bOk = false;
+        }
+    }
+    // i.e. "M1,M2,Sigma"
+    if(bOk && request.contains("derived")) {
+        DerivedQuantities derived;
+        newConfig.derivedQuantities = request.value("derived").toString().split(',', QString::SkipEmptyParts);
+        bOk = derived.select(newConfig.derivedQuantities, &sError);
+    }
+    if(!bOk) {
+        answer.insert("ok", false);
+        answer.insert("error", sError);
+        return answer;
+    }
+    newConfig.averages        = int(averages);
+    newConfig.pointsPerDecade = int(pointsPerDecade);
+    newConfig.extraPoints     = int(extraPoints);
+    if(request.contains("info"))
+        newConfig.sSampleInfo = request.value("info").toString();
+    if(request.contains("frequencyFile"))
+        newConfig.sFrequencyFile = request.value("frequencyFile").toString();
+    if(request.contains("output"))
+        newConfig.sOutputFile = request.value("output").toString();
+    if(request.contains("openCorrection"))
+        newConfig.bOpenCorrection = request.value("openCorrection").toBool();
+    if(request.contains("shortCorrection"))
+        newConfig.bShortCorrection = request.value("shortCorrection").toBool();
+    if(request.contains("binary"))
+        newConfig.bBinaryTransfer = request.value("binary").toBool();
+    configs[iMeter] = newConfig;
+    answer.insert("ok", true);
+    return answer;
+}
+
+
+void
+ControlServer::send(QLocalSocket* pSocket, const QJsonObject& message) {
+    pSocket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n");
+    pSocket->flush();
+}
+
+
+void
+ControlServer::broadcast(QJsonObject event) {
+    int iMeter = senderIndex();
+    if(iMeter >= 0)
+        event.insert("meter", pSessions->name(iMeter));
+    for(int i=0; i<subscribers.count(); i++)
+        send(subscribers.at(i), event);
+}
+
+
+// The points are pushed as soon as they are measured
+void
+ControlServer::onNewPoints(QVector<RunRecord> points) {
+    if(subscribers.isEmpty())
+        return;
+    for(int i=0; i<points.count(); i++) {
+        const RunRecord& point = points.at(i);
+        QJsonObject event;
+        event.insert("event", "point");
+        event.insert("f", point.frequency);
+        event.insert("cp", point.cp);
+        event.insert("d", point.d);
+        event.insert("e1", point.e1);
+        event.insert("e2", point.e2);
+        event.insert("settle", point.settle);
+        event.insert("timestamp", double(point.timestamp));
+        broadcast(event);
+    }
+}
+
+
+void
+ControlServer::onSweepFinished(bool bCompleted) {
+    QJsonObject event;
+    event.insert("event", "finished");
+    event.insert("completed", bCompleted);
+    broadcast(event);
+}
+
+
+void
+ControlServer::onSweepStopped() {
+    QJsonObject event;
+    event.insert("event", "stopped");
+    broadcast(event);
+}
@@ -0,0 +1,94 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonObject>
+#include <QList>
+
+#include "sweep.h"
+#include "sessionmanager.h"
+
+
+// Lets other programs (i.e. the lab automation scripts) drive the measures
+// through a local socket. The protocol is line based: each request and
+// each answer is a JSON object on a single line. Each request can
+// name the meter ("meter":"GPIB0@17" or its index); the first one
+// is used if not given.
+//   {"cmd":"meters"}          Lists the meters and their state
+//   {"cmd":"configure", ...}  Sets the parameters of the next measure
+//                             (area, thickness, info, voltage, averages,
+//                             settling, openCorrection, shortCorrection,
+//                             binary, plan, fmin, fmax, pointsPerDecade,
+//                             frequencyFile, extraPoints, threshold, output,
+//                             derived: i.e. "M1,M2,Sigma")
+//   {"cmd":"start"}           Starts the measure
+//   {"cmd":"resume"}          Resumes the interrupted measure
+//   {"cmd":"stop"}            Stops it
+//   {"cmd":"status"}          Returns running, measured and pending
+//   {"cmd":"subscribe"}       The measured points are pushed as they arrive
+//   {"cmd":"quit"}            Asks the application to exit (quitRequested())
+// Answers are {"ok":true, ...} or {"ok":false, "error":"..."}; pushed
+// events are {"event":"point", ...}, {"event":"finished", "completed":...}
+// and {"event":"stopped"}, all with the name of their meter.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ControlServer(SessionManager* pSessionManager, QObject *parent = nullptr);
+    virtual ~ControlServer();
+
+public:
+    bool listen(QString sName, QString* pErrorString);
+    void close();
+    void setConfig(int iMeter, const SweepConfig& newConfig);
+
+signals:
+    void quitRequested();
+
+protected slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void onMeterAdded(int iMeter);
+    void onNewPoints(QVector<RunRecord> points);
+    void onSweepFinished(bool bCompleted);
+    void onSweepStopped();
+
+protected:
+    QJsonObject execute(QLocalSocket* pSocket, const QJsonObject& request);
+    QJsonObject configure(int iMeter, const QJsonObject& request);
+    int         meterIndex(const QJsonObject& request);
+    int         senderIndex();
+    void        send(QLocalSocket* pSocket, const QJsonObject& message);
+    void        broadcast(QJsonObject event);
+
+private:
+    QLocalServer         server;
+    SessionManager*      pSessions;
+    QVector<SweepConfig> configs; // One for each meter
+    QList<QLocalSocket*> subscribers;
+};
@@ -31,7 +31,13 @@ DataStream2D::DataStream2D(int Id, int PenWidth, QColor Color, int Symbol, QStri
         Properties.Title = QString("Data Set %1").arg(Properties.GetId());
     isShown         = false;
     bShowCurveTitle = false;
-    maxPoints = 100;
+    maxPoints = 0; // Keep all
+    screenSerial = -1;
+    screenFirst = 0;
+    head = 0;
+    nPoints = 0;
+    nAdded = 0;
+    nDescents = 0;
 }
 
 
@@ -41,7 +47,13 @@ DataStream2D::DataStream2D(DataSetProperties myProperties) {
         Properties.Title = QString("Data Set %1").arg(Properties.GetId());
     isShown         = false;
     bShowCurveTitle = false;
-    maxPoints = 100;
+    maxPoints = 0; // Keep all
+    screenSerial = -1;
+    screenFirst = 0;
+    head = 0;
+    nPoints = 0;
+    nAdded = 0;
+    nDescents = 0;
 }
 
 
@@ -55,35 +67,167 @@ DataStream2D::SetShow(bool show) {
 }
 
 
+// Appending a point (and dropping the oldest one when the buffer is
+// full) costs O(1): the extremes are kept by monotonic queues where
+// each point enters and leaves only once.
 void
 DataStream2D::AddPoint(double x, double y) {
-    m_pointArrayX.append(x);
-    m_pointArrayY.append(y);
-    if(m_pointArrayX.count() == 1) {
-        minx = x-DBL_MIN;
-        maxx = x+DBL_MIN;
-        miny = y-DBL_MIN;
-        maxy = y+DBL_MIN;
+    if((maxPoints > 0) && (nPoints == maxPoints))
+        RemoveFirstPoint();
+    if((nPoints > 0) && (x < this->x(nPoints-1)))
+        nDescents++;
+    int i = physical(nPoints);
+    if(i == m_pointArrayX.count()) {
+        m_pointArrayX.append(x);
+        m_pointArrayY.append(y);
+    } else {
+        m_pointArrayX[i] = x;
+        m_pointArrayY[i] = y;
     }
-    if(m_pointArrayX.count() > maxPoints) {
-        m_pointArrayX.remove(0, maxPoints/4);
-        m_pointArrayY.remove(0, maxPoints/4);
-        minx = x-DBL_MIN;
-        maxx = x+DBL_MIN;
-        miny = y-DBL_MIN;
-        maxy = y+DBL_MIN;
-        for(int i=0; i<m_pointArrayX.count(); i++) {
-            if(m_pointArrayX.at(i) < minx) minx = m_pointArrayX.at(i);
-            if(m_pointArrayX.at(i) > maxx) maxx = m_pointArrayX.at(i);
-            if(m_pointArrayY.at(i) < miny) miny = m_pointArrayY.at(i);
-            if(m_pointArrayY.at(i) > maxy) maxy = m_pointArrayY.at(i);
+    nPoints++;
+    qint64 seq = nAdded++;
+    qint64 first = nAdded - nPoints;
+    while(!minXQueue.empty() && this->x(int(minXQueue.back()-first)) >= x) minXQueue.pop_back();
+    while(!maxXQueue.empty() && this->x(int(maxXQueue.back()-first)) <= x) maxXQueue.pop_back();
+    while(!minYQueue.empty() && this->y(int(minYQueue.back()-first)) >= y) minYQueue.pop_back();
+    while(!maxYQueue.empty() && this->y(int(maxYQueue.back()-first)) <= y) maxYQueue.pop_back();
+    minXQueue.push_back(seq);
+    maxXQueue.push_back(seq);
+    minYQueue.push_back(seq);
+    maxYQueue.push_back(seq);
+    minx = this->x(int(minXQueue.front()-first));
+    maxx = this->x(int(maxXQueue.front()-first));
+    miny = this->y(int(minYQueue.front()-first));
+    maxy = this->y(int(maxYQueue.front()-first));
+    if(maxPoints == 0)
+        UpdateLod(nPoints-1);
+}
+
+
+void
+DataStream2D::RemoveFirstPoint() {
+    if(nPoints == 0) return;
+    qint64 first = nAdded - nPoints;
+    if((nPoints > 1) && (x(1) < x(0)))
+        nDescents--;
+    if(minXQueue.front() == first) minXQueue.pop_front();
+    if(maxXQueue.front() == first) maxXQueue.pop_front();
+    if(minYQueue.front() == first) minYQueue.pop_front();
+    if(maxYQueue.front() == first) maxYQueue.pop_front();
+    head = physical(1);
+    nPoints--;
+}
+
+
+// Sequence number (counting from the last RemoveAllPoints()) of the
+// point at index 0.
+qint64
+DataStream2D::firstSequence() {
+    return nAdded - nPoints;
+}
+
+
+bool
+DataStream2D::isSortedX() {
+    return nDescents == 0;
+}
+
+
+// Returns the range of indices of the points with X within [xMin, xMax]
+// plus one point on each side (if present), to draw the segments that
+// cross the frame. The X values must be sorted.
+void
+DataStream2D::GetVisibleRange(double xMin, double xMax, int& iFirst, int& iLast) {
+    int lo = 0;
+    int hi = nPoints;
+    while(lo < hi) { // First point with x >= xMin
+        int mid = (lo + hi) / 2;
+        if(x(mid) < xMin) lo = mid + 1; else hi = mid;
+    }
+    iFirst = qMax(lo-1, 0);
+    hi = nPoints;
+    while(lo < hi) { // First point with x > xMax
+        int mid = (lo + hi) / 2;
+        if(x(mid) <= xMax) lo = mid + 1; else hi = mid;
+    }
+    iLast = qMin(lo, nPoints-1);
+}
+
+
+// Updates the nodes containing the point i at every level of the
+// min/max pyramid, adding the levels (and nodes) that are missing.
+// Each node is computed from its two children, so it costs O(log n).
+void
+DataStream2D::UpdateLod(int i) {
+    int n = i + 1;
+    const double* py = m_pointArrayY.constData(); // head is 0 without limit
+    for(int L=1; ((n-1) >> (L-1)) > 0; L++) {
+        if(lodLevels.count() < L)
+            lodLevels.append(QVector<int>());
+        int j = i >> L;
+        int c0 = 2*j;
+        int c1 = 2*j + 1;
+        int iMin, iMax;
+        if(L == 1) {
+            iMin = iMax = c0;
+            if(c1 < n) {
+                if(py[c1] < py[iMin]) iMin = c1;
+                if(py[c1] > py[iMax]) iMax = c1;
+            }
+        } else {
+            const QVector<int>& child = lodLevels.at(L-2);
+            iMin = child.at(2*c0);
+            iMax = child.at(2*c0+1);
+            if(2*c1 < child.count()) {
+                if(py[child.at(2*c1)]   < py[iMin]) iMin = child.at(2*c1);
+                if(py[child.at(2*c1+1)] > py[iMax]) iMax = child.at(2*c1+1);
+            }
+        }
+        QVector<int>& level = lodLevels[L-1];
+        if(2*j == level.count()) {
+            level.append(iMin);
+            level.append(iMax);
+        } else {
+            level[2*j]   = iMin;
+            level[2*j+1] = iMax;
         }
     }
-    else {
-        minx = minx < x ? minx : x-DBL_MIN;
-        maxx = maxx > x ? maxx : x+DBL_MIN;
-        miny = miny < y ? miny : y-DBL_MIN;
-        maxy = maxy > y ? maxy : y+DBL_MIN;
+}
+
+
+// Returns in indices a subset of the points in [iFirst, iLast] that,
+// drawn as a polyline, looks the same as the whole set when there
+// are no more than nBuckets pixel columns: for each node of the
+// coarsest level with at most nBuckets nodes in the range, its first,
+// minimum, maximum and last point, in the order they were added.
+void
+DataStream2D::GetLodIndices(int iFirst, int iLast, int nBuckets, QVector<int>& indices) {
+    indices.clear();
+    if(nPoints == 0) return;
+    if(iFirst < 0) iFirst = 0;
+    if(iLast > nPoints-1) iLast = nPoints-1;
+    if(iFirst > iLast) return;
+    if(nBuckets < 1) nBuckets = 1;
+    int L = 0;
+    while((L < lodLevels.count()) && (((iLast-iFirst+1) >> L) > nBuckets))
+        L++;
+    if(L == 0) {
+        indices.reserve(iLast-iFirst+1);
+        for(int i=iFirst; i<=iLast; i++)
+            indices.append(i);
+        return;
+    }
+    const QVector<int>& level = lodLevels.at(L-1);
+    indices.reserve(4*((iLast >> L) - (iFirst >> L) + 1));
+    for(int j=(iFirst >> L); j<=(iLast >> L); j++) {
+        int iStart = j << L;
+        int iEnd = qMin(((j+1) << L) - 1, nPoints-1);
+        int iLow  = qMin(level.at(2*j), level.at(2*j+1));
+        int iHigh = qMax(level.at(2*j), level.at(2*j+1));
+        indices.append(iStart);
+        if(iLow  != iStart) indices.append(iLow);
+        if(iHigh != iLow && iHigh != iStart) indices.append(iHigh);
+        if(iEnd  != iHigh && iEnd != iStart) indices.append(iEnd);
     }
 }
 
@@ -104,6 +248,17 @@ void
 DataStream2D::RemoveAllPoints() {
     m_pointArrayX.clear();
     m_pointArrayY.clear();
+    head = 0;
+    nPoints = 0;
+    nAdded = 0;
+    nDescents = 0;
+    minXQueue.clear();
+    maxXQueue.clear();
+    minYQueue.clear();
+    maxYQueue.clear();
+    screenPoints.clear();
+    screenFirst = 0;
+    lodLevels.clear();
 }
 
 
@@ -119,8 +274,8 @@ DataStream2D::SetShowTitle(bool show) {
 }
 
 
-DataSetProperties
-DataStream2D::GetProperties() {
+const DataSetProperties&
+DataStream2D::GetProperties() const {
     return Properties;
 }
 
@@ -132,15 +287,35 @@ DataStream2D::SetProperties(DataSetProperties newProperties) {
 
 
 
-QString
-DataStream2D::GetTitle() {
+const QString&
+DataStream2D::GetTitle() const {
     return Properties.Title;
 }
 
 
+// Changing the limit rebuilds the buffer keeping the newest points.
 void
-DataStream2D::setMaxPoints(int nPoints) {
-    maxPoints = nPoints;
+DataStream2D::setMaxPoints(int nNewMax) {
+    if((nNewMax < 0) || (nNewMax == maxPoints))
+        return;
+    int iFirst = 0;
+    if((nNewMax > 0) && (nPoints > nNewMax))
+        iFirst = nPoints - nNewMax;
+    QVector<double> oldX, oldY;
+    oldX.reserve(nPoints-iFirst);
+    oldY.reserve(nPoints-iFirst);
+    for(int i=iFirst; i<nPoints; i++) {
+        oldX.append(x(i));
+        oldY.append(y(i));
+    }
+    RemoveAllPoints();
+    maxPoints = nNewMax;
+    if(maxPoints > 0) {
+        m_pointArrayX.reserve(maxPoints);
+        m_pointArrayY.reserve(maxPoints);
+    }
+    for(int i=0; i<oldX.count(); i++)
+        AddPoint(oldX.at(i), oldY.at(i));
 }
 
 
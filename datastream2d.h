@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QVector>
 #include <QColor>
+#include <QPolygonF>
+#include <deque>
 
 #include "DataSetProperties.h"
 
@@ -35,26 +37,68 @@ public:
     void AddPoint(double pointX, double pointY);
     void RemoveAllPoints();
     int  GetId();
-    QString GetTitle();
-    DataSetProperties GetProperties();
+    const QString& GetTitle() const;
+    const DataSetProperties& GetProperties() const;
     void SetProperties(DataSetProperties newProperties);
     void SetColor(QColor Color);
     void SetShowTitle(bool show);
     void SetTitle(QString myTitle);
     void SetShow(bool);
+    void GetLodIndices(int iFirst, int iLast, int nBuckets, QVector<int>& indices);
+    void GetVisibleRange(double xMin, double xMax, int& iFirst, int& iLast);
+    bool isSortedX();
+    qint64 firstSequence();
+    // Points are indexed from the oldest (0) to the newest (count()-1)
+    inline int count() const { return nPoints; }
+    inline double x(int i) const { return m_pointArrayX.at(physical(i)); }
+    inline double y(int i) const { return m_pointArrayY.at(physical(i)); }
+    // The X and Y values are in separate arrays: the points from index i
+    // on are contiguous in memory up to the end of the circular buffer
+    inline const double* xData(int i) const { return m_pointArrayX.constData()+physical(i); }
+    inline const double* yData(int i) const { return m_pointArrayY.constData()+physical(i); }
+    inline int contiguousCount(int i) const {
+        return qMin(nPoints-i, int(m_pointArrayX.count())-physical(i));
+    }
+
+ protected:
+    inline int physical(int i) const {
+        i += head;
+        return (maxPoints > 0) && (i >= maxPoints) ? i-maxPoints : i;
+    }
+    void RemoveFirstPoint();
+    void UpdateLod(int i);
 
  // Attributes
  public:
-    QVector<double> m_pointArrayX;
-    QVector<double> m_pointArrayY;
     double minx;
     double maxx;
     double miny;
     double maxy;
     bool bShowCurveTitle;
     bool isShown;
+    // Points already transformed to screen coordinates by the Plot2D,
+    // the transform serial they refer to (see Plot2D::TransformData)
+    // and the sequence number of the first one
+    QPolygonF screenPoints;
+    int screenSerial;
+    qint64 screenFirst;
 
  protected:
     DataSetProperties Properties;
-    int maxPoints;
+    int maxPoints; // 0 means no limit
+    // When maxPoints > 0 the points are kept in a circular buffer
+    // of maxPoints elements and the oldest one is at index head
+    QVector<double> m_pointArrayX;
+    QVector<double> m_pointArrayY;
+    int head;
+    int nPoints;
+    qint64 nAdded;  // Points added since the last RemoveAllPoints()
+    int nDescents;  // Points with X lower than the previous one
+    // Sequence numbers of the candidate extremes of the points in the
+    // buffer (monotonic queues): the front is the current extreme
+    std::deque<qint64> minXQueue, maxXQueue, minYQueue, maxYQueue;
+    // Min/max pyramid (only when maxPoints is 0): lodLevels[L-1] holds,
+    // for each node of 2^L consecutive points, the indices of its
+    // minimum and maximum Y
+    QVector<QVector<int>> lodLevels;
 };
@@ -0,0 +1,276 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "datawriter.h"
+
+#include <stdio.h>
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+#if __cplusplus >= 201703L && __has_include(<charconv>)
+#include <charconv>
+#endif
+
+
+DataWriter::DataWriter(QObject *parent)
+    : QObject(parent)
+    , pQueue(new Record[QUEUE_SIZE])
+    , queueHead(0)
+    , queueTail(0)
+    , bOpen(false)
+    , flushBytes(64*1024)
+    , flushMs(1000)
+    , pFile(nullptr)
+{
+    pWriterThread = QThread::create([this]() { writerLoop(); });
+    pWriterThread->setObjectName("DataWriter");
+    pWriterThread->start();
+}
+
+
+// Waits for all the pending rows to be written.
+DataWriter::~DataWriter() {
+    close();
+    Record* pRecord = beginRecord();
+    pRecord->type = STOP;
+    commitRecord();
+    pWriterThread->wait();
+    delete pWriterThread;
+    delete[] pQueue;
+}
+
+
+// The file is opened (and errors reported) in the caller thread,
+// then it is handed to the writer thread. A file still open is
+// closed first.
+bool
+DataWriter::open(QString sFileName, QIODevice::OpenMode mode, QString* pErrorString) {
+    close();
+    QFile* pNewFile = new QFile(sFileName);
+    if(!pNewFile->open(mode)) {
+        if(pErrorString)
+            *pErrorString = pNewFile->errorString();
+        delete pNewFile;
+        return false;
+    }
+    pNewFile->moveToThread(pWriterThread);
+    Record* pRecord = beginRecord();
+    pRecord->type  = OPEN_FILE;
+    pRecord->pFile = pNewFile;
+    commitRecord();
+    bOpen = true;
+    return true;
+}
+
+
+// Writes the pending data, fsync() and closes the file
+// without waiting for the operation to complete.
+void
+DataWriter::close() {
+    if(!bOpen)
+        return;
+    beginRecord()->type = CLOSE_FILE;
+    commitRecord();
+    bOpen = false;
+}
+
+
+bool
+DataWriter::isOpen() {
+    return bOpen;
+}
+
+
+void
+DataWriter::setFlushPolicy(int maxBytes, int maxMs) {
+    flushBytes.storeRelease(maxBytes);
+    flushMs.storeRelease(maxMs);
+}
+
+
+// Appends a row with nValues numbers formatted as "%12.6g"
+// separated by a blank.
+void
+DataWriter::writeValues(const double* values, int nValues) {
+    if(!bOpen)
+        return;
+    if(nValues > MAX_VALUES)
+        nValues = MAX_VALUES;
+    Record* pRecord = beginRecord();
+    pRecord->type = VALUES;
+    pRecord->nValues = nValues;
+    for(int i=0; i<nValues; i++)
+        pRecord->values[i] = values[i];
+    commitRecord();
+}
+
+
+void
+DataWriter::writeData(QByteArray data) {
+    if(!bOpen)
+        return;
+    Record* pRecord = beginRecord();
+    pRecord->type = BYTES;
+    pRecord->data = data;
+    commitRecord();
+}
+
+
+// Writes the pending data and fsync() the file (i.e. at the end of
+// a sweep) without waiting for the operation to complete.
+void
+DataWriter::sync() {
+    if(!bOpen)
+        return;
+    beginRecord()->type = SYNC;
+    commitRecord();
+}
+
+
+// Returns the first free record of the queue. The queue is full only
+// if the disk is hopelessly slow: in this case wait for a free record.
+DataWriter::Record*
+DataWriter::beginRecord() {
+    quint32 tail = queueTail.loadAcquire();
+    while(tail - queueHead.loadAcquire() >= quint32(QUEUE_SIZE))
+        QThread::yieldCurrentThread();
+    return &pQueue[tail & (QUEUE_SIZE-1)];
+}
+
+
+// Publishes the record returned by beginRecord() to the writer thread.
+void
+DataWriter::commitRecord() {
+    queueTail.storeRelease(queueTail.loadAcquire()+1);
+    recordsReady.release();
+}
+
+
+void
+DataWriter::writerLoop() {
+    forever {
+        bool bReady;
+        if(buffer.isEmpty()) {
+            recordsReady.acquire();
+            bReady = true;
+        } else {
+            int waitMs = flushMs.loadAcquire() - int(lastFlush.elapsed());
+            bReady = recordsReady.tryAcquire(1, qMax(waitMs, 0));
+        }
+        if(bReady) {
+            quint32 head = queueHead.loadAcquire();
+            Record& record = pQueue[head & (QUEUE_SIZE-1)];
+            RecordType type = record.type;
+            process(record);
+            record.data.clear();
+            queueHead.storeRelease(head+1);
+            if(type == STOP)
+                return;
+        }
+        if((buffer.size() >= flushBytes.loadAcquire()) ||
+           (!buffer.isEmpty() && (lastFlush.elapsed() >= flushMs.loadAcquire())))
+        {
+            flushBuffer(false);
+        }
+    }
+}
+
+
+void
+DataWriter::process(Record& record) {
+    switch(record.type) {
+    case OPEN_FILE:
+        closeFile();
+        pFile = record.pFile;
+        lastFlush.start();
+        break;
+    case VALUES:
+        formatValues(record);
+        break;
+    case BYTES:
+        buffer.append(record.data);
+        break;
+    case SYNC:
+        flushBuffer(true);
+        break;
+    case CLOSE_FILE:
+    case STOP:
+        closeFile();
+        break;
+    }
+}
+
+
+void
+DataWriter::formatValues(const Record& record) {
+    char field[64];
+    for(int i=0; i<record.nValues; i++) {
+        if(i > 0)
+            buffer.append(' ');
+#if defined(__cpp_lib_to_chars)
+        char* pEnd = std::to_chars(field, field+sizeof(field), record.values[i],
+                                   std::chars_format::general, FIELD_DIGITS).ptr;
+        int nChars = int(pEnd - field);
+        if(nChars < FIELD_WIDTH)
+            buffer.append(FIELD_WIDTH-nChars, ' ');
+        buffer.append(field, nChars);
+#else
+        int nChars = snprintf(field, sizeof(field), "%*.*g",
+                              FIELD_WIDTH, FIELD_DIGITS, record.values[i]);
+        buffer.append(field, qMin(nChars, int(sizeof(field))-1));
+#endif
+    }
+    buffer.append('\n');
+}
+
+
+void
+DataWriter::flushBuffer(bool bSync) {
+    lastFlush.restart();
+    if(!pFile) {
+        buffer.clear();
+        return;
+    }
+    if(!buffer.isEmpty()) {
+        if(pFile->write(buffer) != buffer.size())
+            emit writeError(pFile->fileName() + ": " + pFile->errorString());
+        buffer.clear();
+    }
+    pFile->flush();
+#if defined(Q_OS_UNIX)
+    if(bSync)
+        fsync(pFile->handle());
+#else
+    Q_UNUSED(bSync)
+#endif
+}
+
+
+void
+DataWriter::closeFile() {
+    if(!pFile)
+        return;
+    flushBuffer(true);
+    pFile->close();
+    delete pFile;
+    pFile = nullptr;
+}
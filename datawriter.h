@@ -0,0 +1,105 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QFile>
+#include <QByteArray>
+#include <QSemaphore>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+
+
+// Writes a (text or binary) file from a dedicated thread so that the
+// disk latency never stalls the caller. Data are passed through a lock-free
+// single producer / single consumer queue: all the writing functions
+// must be called from the same thread (i.e. the GUI one).
+// The data are written to disk when more than flushBytes are pending,
+// when flushMs have elapsed since the last write and on sync() or
+// close(), that also fsync() the file.
+class DataWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DataWriter(QObject *parent = nullptr);
+    virtual ~DataWriter();
+
+public:
+    bool open(QString sFileName, QIODevice::OpenMode mode, QString* pErrorString);
+    void close();
+    bool isOpen();
+    void setFlushPolicy(int maxBytes, int maxMs);
+    void writeValues(const double* values, int nValues);
+    void writeData(QByteArray data);
+    void sync();
+
+signals:
+    void writeError(QString sError);
+
+public:
+    static const int MAX_VALUES   = 12;   // Per row (6 measured + the derived ones)
+    static const int QUEUE_SIZE   = 1024; // Must be a power of 2
+    static const int FIELD_WIDTH  = 12;
+    static const int FIELD_DIGITS = 6;
+
+protected:
+    enum RecordType {
+        OPEN_FILE,
+        VALUES,
+        BYTES,
+        SYNC,
+        CLOSE_FILE,
+        STOP
+    };
+    struct Record {
+        RecordType type;
+        int        nValues;
+        double     values[MAX_VALUES];
+        QByteArray data;
+        QFile*     pFile;
+    };
+
+protected:
+    Record* beginRecord();
+    void    commitRecord();
+    void    writerLoop();
+    void    process(Record& record);
+    void    formatValues(const Record& record);
+    void    flushBuffer(bool bSync);
+    void    closeFile();
+
+private:
+    QThread*                pWriterThread;
+    Record*                 pQueue;
+    QAtomicInteger<quint32> queueHead; // Next record to be written
+    QAtomicInteger<quint32> queueTail; // Next free record
+    QSemaphore              recordsReady;
+    bool                    bOpen;     // As seen by the producer
+    QAtomicInt              flushBytes;
+    QAtomicInt              flushMs;
+    // Used by the writer thread only
+    QFile*                  pFile;
+    QByteArray              buffer;
+    QElapsedTimer           lastFlush;
+};
@@ -0,0 +1,240 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "derivedquantities.h"
+
+#include <algorithm>
+#include <math.h>
+
+
+static const double E0 = 8.854e-12;
+
+
+typedef double (*PointFunction)(const RunRecord& point, double c0);
+
+
+// E' = Cp/C0  E" = D*E'
+static double
+modulusReal(const RunRecord& point, double c0) {
+    double e1 = point.cp/c0;
+    double e2 = point.d*e1;
+    return e1/(e1*e1 + e2*e2);
+}
+
+
+static double
+modulusImaginary(const RunRecord& point, double c0) {
+    double e1 = point.cp/c0;
+    double e2 = point.d*e1;
+    return e2/(e1*e1 + e2*e2);
+}
+
+
+// sigma' = e0*omega*E"
+static double
+conductivity(const RunRecord& point, double c0) {
+    return E0*2.0*M_PI*point.frequency*point.d*point.cp/c0;
+}
+
+
+// Z = 1/(G + i*omega*Cp) with G = omega*Cp*D
+static double
+impedanceReal(const RunRecord& point, double c0) {
+    Q_UNUSED(c0)
+    double omegaC = 2.0*M_PI*point.frequency*point.cp;
+    return point.d/(omegaC*(1.0 + point.d*point.d));
+}
+
+
+static double
+impedanceImaginary(const RunRecord& point, double c0) {
+    Q_UNUSED(c0)
+    double omegaC = 2.0*M_PI*point.frequency*point.cp;
+    return -1.0/(omegaC*(1.0 + point.d*point.d));
+}
+
+
+// New quantities are added here (and to the ids in the header)
+static const struct {
+    const char*   sName;
+    const char*   sLabel;
+    PointFunction pFunction; // nullptr if only computed by batch()
+} quantityTable[DerivedQuantities::N_QUANTITIES] = {
+    {"M1",    "M1",         modulusReal},
+    {"M2",    "M2",         modulusImaginary},
+    {"Sigma", "Sigma[S/m]", conductivity},
+    {"Z1",    "Z1[Ohm]",    impedanceReal},
+    {"Z2",    "Z2[Ohm]",    impedanceImaginary},
+    {"E2der", "E2der",      nullptr},
+};
+
+
+DerivedQuantities::DerivedQuantities() {
+}
+
+
+QString
+DerivedQuantities::name(int iQuantity) {
+    return QString(quantityTable[iQuantity].sName);
+}
+
+
+// The column header
+QString
+DerivedQuantities::label(int iQuantity) {
+    return QString(quantityTable[iQuantity].sLabel);
+}
+
+
+// -1 if unknown
+int
+DerivedQuantities::fromName(QString sName) {
+    for(int i=0; i<N_QUANTITIES; i++) {
+        if(sName.trimmed().compare(quantityTable[i].sName, Qt::CaseInsensitive) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+bool
+DerivedQuantities::isPointwise(int iQuantity) {
+    return quantityTable[iQuantity].pFunction != nullptr;
+}
+
+
+// Not defined (0) for the batch only quantities
+double
+DerivedQuantities::value(int iQuantity, const RunRecord& point, double c0) {
+    if(!isPointwise(iQuantity))
+        return 0.0;
+    return quantityTable[iQuantity].pFunction(point, c0);
+}
+
+
+// The quantity for all the points (in the same order) at once. The
+// derivative, in ln(omega), is taken on the frequency sorted spectrum
+// with the three points formula for unequal steps (the adaptive plan
+// makes them unequal) and with one sided differences at the ends.
+QVector<double>
+DerivedQuantities::batch(int iQuantity, const QVector<RunRecord>& points, double c0) {
+    int n = points.count();
+    QVector<double> values(n, 0.0);
+    if(isPointwise(iQuantity)) {
+        PointFunction pFunction = quantityTable[iQuantity].pFunction;
+        for(int i=0; i<n; i++)
+            values[i] = pFunction(points.at(i), c0);
+        return values;
+    }
+    QVector<int> order(n);
+    for(int i=0; i<n; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&points](int a, int b) {
+        return points.at(a).frequency < points.at(b).frequency;
+    });
+    QVector<double> u(n), e1(n);
+    for(int i=0; i<n; i++) {
+        u[i]  = log(points.at(order.at(i)).frequency);
+        e1[i] = points.at(order.at(i)).cp/c0;
+    }
+    for(int i=0; i<n; i++) {
+        double derivative = 0.0;
+        double h1 = (i > 0)   ? u.at(i)-u.at(i-1) : 0.0;
+        double h2 = (i < n-1) ? u.at(i+1)-u.at(i) : 0.0;
+        if(h1 > 0.0 && h2 > 0.0)
+            derivative = (h1*h1*(e1.at(i+1)-e1.at(i)) + h2*h2*(e1.at(i)-e1.at(i-1))) /
+                         (h1*h2*(h1+h2));
+        else if(h2 > 0.0)
+            derivative = (e1.at(i+1)-e1.at(i))/h2;
+        else if(h1 > 0.0)
+            derivative = (e1.at(i)-e1.at(i-1))/h1;
+        values[order.at(i)] = -0.5*M_PI*derivative;
+    }
+    return values;
+}
+
+
+// The quantities named, i.e., "M1", "Sigma" or "E2der" (case insensitive)
+bool
+DerivedQuantities::select(QStringList names, QString* pErrorString) {
+    QVector<int> newQuantities;
+    for(int i=0; i<names.count(); i++) {
+        if(names.at(i).trimmed().isEmpty())
+            continue;
+        int iQuantity = fromName(names.at(i));
+        if(iQuantity < 0) {
+            QStringList known;
+            for(int j=0; j<N_QUANTITIES; j++)
+                known.append(name(j));
+            if(pErrorString) *pErrorString = QString("Unknown derived quantity: %1 [%2]")
+                                             .arg(names.at(i), known.join(", "));
+            return false;
+        }
+        if(!newQuantities.contains(iQuantity))
+            newQuantities.append(iQuantity);
+    }
+    quantities = newQuantities;
+    return true;
+}
+
+
+QVector<int>
+DerivedQuantities::selected() const {
+    return quantities;
+}
+
+
+int
+DerivedQuantities::pointwiseCount() const {
+    int nPointwise = 0;
+    for(int i=0; i<quantities.count(); i++) {
+        if(isPointwise(quantities.at(i)))
+            nPointwise++;
+    }
+    return nPointwise;
+}
+
+
+// The headers of the columns written by compute(), each one preceded by a space
+QString
+DerivedQuantities::header() const {
+    QString sHeader;
+    for(int i=0; i<quantities.count(); i++) {
+        if(isPointwise(quantities.at(i)))
+            sHeader += QString(" %1").arg(label(quantities.at(i)), 12);
+    }
+    return sHeader;
+}
+
+
+// The selected pointwise quantities of a point.
+// Returns the number of values written to pValues.
+int
+DerivedQuantities::compute(const RunRecord& point, double c0, double* pValues) const {
+    int nValues = 0;
+    for(int i=0; i<quantities.count(); i++) {
+        PointFunction pFunction = quantityTable[quantities.at(i)].pFunction;
+        if(pFunction)
+            pValues[nValues++] = pFunction(point, c0);
+    }
+    return nValues;
+}
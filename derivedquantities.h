@@ -0,0 +1,69 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#include "runfile.h"
+
+
+// The quantities derived from the measured Cp-D and from C0: the
+// electric modulus M* = 1/E*, the AC conductivity, the impedance of the
+// sample (Cp in parallel with G = omega*Cp*D) and the conduction-free
+// derivative loss E"der = -(pi/2)*dE'/d(ln omega).
+// Most are computed point by point, as the points arrive. The derivative
+// needs the neighbouring frequencies, so it is only available from
+// batch(), on the complete spectrum.
+class DerivedQuantities
+{
+public:
+    DerivedQuantities();
+
+public:
+    static QString name(int iQuantity);
+    static QString label(int iQuantity);
+    static int     fromName(QString sName);
+    static bool    isPointwise(int iQuantity);
+    static double  value(int iQuantity, const RunRecord& point, double c0);
+    static QVector<double> batch(int iQuantity, const QVector<RunRecord>& points, double c0);
+
+    bool         select(QStringList names, QString* pErrorString);
+    QVector<int> selected() const;
+    int          pointwiseCount() const;
+    QString      header() const;
+    int          compute(const RunRecord& point, double c0, double* pValues) const;
+
+public:
+    static const int M1            = 0;
+    static const int M2            = 1;
+    static const int SIGMA         = 2;
+    static const int Z1            = 3;
+    static const int Z2            = 4;
+    static const int E2_DERIVATIVE = 5;
+    static const int N_QUANTITIES  = 6;
+
+private:
+    QVector<int> quantities;
+};
@@ -23,10 +23,16 @@
 QT += core
 QT += gui
 QT += widgets
+QT += network
 
 TARGET = dielectric
 TEMPLATE = app
 
+# std::to_chars (datawriter.cpp) needs C++17
+CONFIG += c++17
+# MSVC reports __cplusplus as 199711L without this
+msvc: QMAKE_CXXFLAGS += /Zc:__cplusplus
+
 #DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
@@ -41,8 +47,22 @@ LIBS += -L"/usr/local/lib" -lgpib # To include libgpib.so from /usr/local/lib
 SOURCES += main.cpp
 SOURCES += correctionsdialog.cpp
 SOURCES += hp4284tab.cpp
+SOURCES += frequencytab.cpp
+SOURCES += frequencyplan.cpp
 SOURCES += gpibdevice.cpp
+SOURCES += gpibtransport.cpp
+SOURCES += hp4284asimulator.cpp
 SOURCES += datastream2d.cpp
+SOURCES += datawriter.cpp
+SOURCES += runfile.cpp
+SOURCES += sweep.cpp
+SOURCES += controlserver.cpp
+SOURCES += sessionmanager.cpp
+SOURCES += instrumentdiscovery.cpp
+SOURCES += relaxationfit.cpp
+SOURCES += spectrumanalyzer.cpp
+SOURCES += kramerskronig.cpp
+SOURCES += derivedquantities.cpp
 SOURCES += plotpropertiesdlg.cpp
 SOURCES += configuredlg.cpp
 SOURCES += filetab.cpp
@@ -52,13 +72,28 @@ SOURCES += AxisFrame.cpp
 SOURCES += AxisLimits.cpp
 SOURCES += DataSetProperties.cpp
 SOURCES += plot2d.cpp
+SOURCES += plottransform.cpp
 SOURCES += mainwindow.cpp
 
 HEADERS += mainwindow.h
 HEADERS += correctionsdialog.h
 HEADERS += hp4284tab.h
+HEADERS += frequencytab.h
+HEADERS += frequencyplan.h
 HEADERS += gpibdevice.h
+HEADERS += gpibtransport.h
+HEADERS += hp4284asimulator.h
 HEADERS += datastream2d.h
+HEADERS += datawriter.h
+HEADERS += runfile.h
+HEADERS += sweep.h
+HEADERS += controlserver.h
+HEADERS += sessionmanager.h
+HEADERS += instrumentdiscovery.h
+HEADERS += relaxationfit.h
+HEADERS += spectrumanalyzer.h
+HEADERS += kramerskronig.h
+HEADERS += derivedquantities.h
 HEADERS += plotpropertiesdlg.h
 HEADERS += configuredlg.h
 HEADERS += filetab.h
@@ -68,6 +103,7 @@ HEADERS += AxisFrame.h
 HEADERS += AxisLimits.h
 HEADERS += DataSetProperties.h
 HEADERS += plot2d.h
+HEADERS += plottransform.h
 
 DISTFILES += docs/Agilent_HP4284A.pdf
 DISTFILES += docs/Agilent 16451.pdf
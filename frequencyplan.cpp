@@ -0,0 +1,273 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "frequencyplan.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegExp>
+#include <algorithm>
+#include <math.h>
+
+
+// The HP 4284A test frequency range
+static const double MIN_FREQUENCY = 20.0;
+static const double MAX_FREQUENCY = 1.0e6;
+// Intervals narrower than this ratio are not split any more
+static const double MIN_RATIO     = 1.01;
+
+
+FrequencyPlan::FrequencyPlan()
+    : bAdaptive(false)
+    , extraPoints(0)
+    , maxExtra(0)
+    , maxChange(0.1)
+{
+}
+
+
+// The instrument rounds the test frequency anyway: 4 significant
+// digits avoid showing frequencies like 31.6227766 Hz.
+double
+FrequencyPlan::roundFrequency(double f) {
+    if(f <= 0.0)
+        return f;
+    double scale = pow(10.0, floor(log10(f)) - 3.0);
+    return qBound(MIN_FREQUENCY, round(f/scale)*scale, MAX_FREQUENCY);
+}
+
+
+// The plan named "log", "file" or "adaptive" (i.e. on the command line)
+// or -1 if unknown.
+int
+FrequencyPlan::modeFromName(QString sName) {
+    if(sName == "log")
+        return LOG_GRID;
+    if(sName == "file")
+        return FILE_LIST;
+    if(sName == "adaptive")
+        return ADAPTIVE;
+    return -1;
+}
+
+
+// pointsPerDecade logarithmically spaced frequencies, aligned to the
+// decades (i.e. 100Hz, 1kHz...), from fMin up to fMax (both included).
+QVector<double>
+FrequencyPlan::logGrid(double fMin, double fMax, int pointsPerDecade) {
+    QVector<double> frequencies;
+    fMin = qBound(MIN_FREQUENCY, fMin, MAX_FREQUENCY);
+    fMax = qBound(MIN_FREQUENCY, fMax, MAX_FREQUENCY);
+    if((fMax < fMin) || (pointsPerDecade < 1))
+        return frequencies;
+    frequencies.append(roundFrequency(fMin));
+    int kFirst = int(ceil(log10(fMin)*pointsPerDecade));
+    int kLast  = int(floor(log10(fMax)*pointsPerDecade));
+    for(int k=kFirst; k<=kLast; k++) {
+        double f = roundFrequency(pow(10.0, double(k)/pointsPerDecade));
+        if(f > frequencies.last())
+            frequencies.append(f);
+    }
+    double f = roundFrequency(fMax);
+    if(f > frequencies.last())
+        frequencies.append(f);
+    return frequencies;
+}
+
+
+// A text file with the frequencies (in Hz) separated by blanks, commas
+// or new lines. Everything following a '#' is a comment.
+// The frequencies are sorted and the duplicates removed.
+QVector<double>
+FrequencyPlan::loadFile(QString sFileName, QString* pErrorString) {
+    QVector<double> frequencies;
+    QFile inFile(sFileName);
+    if(!inFile.open(QIODevice::ReadOnly|QIODevice::Text)) {
+        if(pErrorString)
+            *pErrorString = inFile.errorString();
+        return frequencies;
+    }
+    QTextStream in(&inFile);
+    int nLine = 0;
+    while(!in.atEnd()) {
+        QString sLine = in.readLine();
+        nLine++;
+        int iComment = sLine.indexOf('#');
+        if(iComment >= 0)
+            sLine = sLine.left(iComment);
+        QStringList sValues = sLine.split(QRegExp("[\\s,;]+"), QString::SkipEmptyParts);
+        for(int i=0; i<sValues.count(); i++) {
+            bool bOk;
+            double f = sValues.at(i).toDouble(&bOk);
+            if(!bOk || (f < MIN_FREQUENCY) || (f > MAX_FREQUENCY)) {
+                if(pErrorString)
+                    *pErrorString = QString("Line %1: invalid frequency \"%2\"")
+                                    .arg(nLine)
+                                    .arg(sValues.at(i));
+                return QVector<double>();
+            }
+            frequencies.append(f);
+        }
+    }
+    std::sort(frequencies.begin(), frequencies.end());
+    frequencies.erase(std::unique(frequencies.begin(), frequencies.end()),
+                      frequencies.end());
+    if(frequencies.isEmpty() && pErrorString)
+        *pErrorString = QString("No frequencies in %1").arg(sFileName);
+    return frequencies;
+}
+
+
+// In adaptive mode up to maxExtraPoints will be added to the initial
+// frequencies, splitting the intervals where the (logarithmic) change
+// of E" or of tan(delta) is greater than threshold.
+void
+FrequencyPlan::start(QVector<double> initialFrequencies, bool bAdaptiveMode,
+                     int maxExtraPoints, double threshold) {
+    pending     = initialFrequencies;
+    measured.clear();
+    bAdaptive   = bAdaptiveMode;
+    extraPoints = 0;
+    maxExtra    = qMax(maxExtraPoints, 0);
+    maxChange   = threshold;
+}
+
+
+bool
+FrequencyPlan::hasPending() {
+    return !pending.isEmpty();
+}
+
+
+// The frequencies still to measure in the current pass
+int
+FrequencyPlan::pendingCount() {
+    return pending.count();
+}
+
+
+// The next frequencies, without removing them from the plan
+QVector<double>
+FrequencyPlan::nextFrequencies(int maxPoints) {
+    return pending.mid(0, maxPoints);
+}
+
+
+QVector<double>
+FrequencyPlan::takeNext(int maxPoints) {
+    QVector<double> next = pending.mid(0, maxPoints);
+    pending.remove(0, next.count());
+    return next;
+}
+
+
+void
+FrequencyPlan::addResult(double f, double e2, double tanD) {
+    Point point;
+    point.f    = f;
+    point.e2   = e2;
+    point.tanD = tanD;
+    QVector<Point>::iterator it = std::lower_bound(measured.begin(), measured.end(), point,
+                                                   [](const Point& a, const Point& b) {
+        return a.f < b.f;
+    });
+    measured.insert(it, point);
+}
+
+
+// Adds a result measured before an interruption (see MainWindow::resumeRun()):
+// its frequency is no more pending or, if it has been added by the
+// adaptive refinement, it counts as an extra point.
+void
+FrequencyPlan::resumeResult(double f, double e2, double tanD) {
+    int i = pending.indexOf(f);
+    if(i >= 0)
+        pending.remove(i);
+    else
+        extraPoints++;
+    addResult(f, e2, tanD);
+}
+
+
+// Prepares the frequencies of the next adaptive pass: the geometric
+// midpoints of the intervals where the spectrum changes faster.
+// The intervals around a maximum (or minimum) are always split, to
+// locate the relaxation peaks. Returns false when nothing is left to do.
+bool
+FrequencyPlan::refine() {
+    if(!bAdaptive || (extraPoints >= maxExtra) || (measured.count() < 2))
+        return false;
+    const int nIntervals = measured.count()-1;
+    QVector<double> score(nIntervals, 0.0);
+    for(int i=0; i<nIntervals; i++) {
+        const Point& p0 = measured.at(i);
+        const Point& p1 = measured.at(i+1);
+        double dE2   = fabs(log(qMax(fabs(p1.e2),   1.0e-30)/qMax(fabs(p0.e2),   1.0e-30)));
+        double dTanD = fabs(log(qMax(fabs(p1.tanD), 1.0e-30)/qMax(fabs(p0.tanD), 1.0e-30)));
+        score[i] = qMax(dE2, dTanD);
+    }
+    for(int i=1; i<nIntervals; i++) {
+        double dPrevE2 = measured.at(i).e2     - measured.at(i-1).e2;
+        double dNextE2 = measured.at(i+1).e2   - measured.at(i).e2;
+        double dPrevTD = measured.at(i).tanD   - measured.at(i-1).tanD;
+        double dNextTD = measured.at(i+1).tanD - measured.at(i).tanD;
+        if((dPrevE2*dNextE2 < 0.0) || (dPrevTD*dNextTD < 0.0)) {
+            score[i-1] = qMax(score.at(i-1), 2.0*maxChange);
+            score[i]   = qMax(score.at(i),   2.0*maxChange);
+        }
+    }
+    QVector<int> candidates;
+    for(int i=0; i<nIntervals; i++) {
+        if(score.at(i) <= maxChange)
+            continue;
+        if(measured.at(i+1).f/measured.at(i).f < MIN_RATIO)
+            continue;
+        candidates.append(i);
+    }
+    std::sort(candidates.begin(), candidates.end(), [&score](int a, int b) {
+        return score.at(a) > score.at(b);
+    });
+    for(int i=0; i<candidates.count() && extraPoints<maxExtra; i++) {
+        double f0 = measured.at(candidates.at(i)).f;
+        double f1 = measured.at(candidates.at(i)+1).f;
+        double f  = roundFrequency(sqrt(f0*f1));
+        if((f <= f0) || (f >= f1))
+            continue;
+        pending.append(f);
+        extraPoints++;
+    }
+    std::sort(pending.begin(), pending.end());
+    return !pending.isEmpty();
+}
+
+
+int
+FrequencyPlan::measuredCount() {
+    return measured.count();
+}
+
+
+bool
+FrequencyPlan::isAdaptive() {
+    return bAdaptive;
+}
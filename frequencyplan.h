@@ -0,0 +1,75 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QVector>
+#include <QString>
+
+
+// The list of frequencies to measure. It can be a logarithmic grid,
+// a list read from a file or, in adaptive mode, a coarse logarithmic
+// grid refined, pass after pass, where E" or tan(delta) are changing
+// faster (i.e. near the relaxation peaks).
+class FrequencyPlan
+{
+public:
+    FrequencyPlan();
+
+public:
+    static QVector<double> logGrid(double fMin, double fMax, int pointsPerDecade);
+    static QVector<double> loadFile(QString sFileName, QString* pErrorString);
+    static double          roundFrequency(double f);
+    static int             modeFromName(QString sName);
+
+    void            start(QVector<double> initialFrequencies, bool bAdaptive,
+                          int maxExtraPoints = 0, double threshold = 0.1);
+    bool            hasPending();
+    int             pendingCount();
+    QVector<double> nextFrequencies(int maxPoints);
+    QVector<double> takeNext(int maxPoints);
+    void            addResult(double f, double e2, double tanD);
+    void            resumeResult(double f, double e2, double tanD);
+    bool            refine();
+    int             measuredCount();
+    bool            isAdaptive();
+
+public:
+    static const int LOG_GRID  = 0;
+    static const int FILE_LIST = 1;
+    static const int ADAPTIVE  = 2;
+
+protected:
+    struct Point {
+        double f;
+        double e2;
+        double tanD;
+    };
+
+private:
+    QVector<double> pending;
+    QVector<Point>  measured; // Sorted by frequency
+    bool            bAdaptive;
+    int             extraPoints;
+    int             maxExtra;
+    double          maxChange;
+};
@@ -0,0 +1,282 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "frequencytab.h"
+#include "frequencyplan.h"
+
+#include <QLabel>
+#include <QSettings>
+#include <QMessageBox>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QGridLayout>
+
+
+FrequencyTab::FrequencyTab(QWidget *parent)
+    : QWidget(parent)
+{
+    initUI();
+
+    sNormalStyle = editMinFrequency.styleSheet();
+
+    sErrorStyle  = "QLineEdit { ";
+    sErrorStyle += "color: rgb(255, 255, 255);";
+    sErrorStyle += "background: rgb(255, 0, 0);";
+    sErrorStyle += "selection-background-color: rgb(128, 128, 255);";
+    sErrorStyle += "}";
+
+    restoreSettings();
+    connectSignals();
+    setToolTips();
+}
+
+
+void
+FrequencyTab::initUI() {
+    // The item indexes are the FrequencyPlan modes
+    comboMode.addItem("Logarithmic Grid");
+    comboMode.addItem("Frequencies File");
+    comboMode.addItem("Adaptive");
+    fileButton.setText(QString("..."));
+
+    // Build the Tab layout
+    QGridLayout* pLayout = new QGridLayout();
+
+    pLayout->addWidget(new QLabel("Frequency Plan"),        0, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Min Frequency[Hz]"),     1, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Max Frequency[Hz]"),     2, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Points per Decade"),     3, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Frequencies File"),      4, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Max Added Points"),      5, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Refine Threshold"),      6, 0, 1, 1);
+
+    pLayout->addWidget(&comboMode,            0, 1, 1, 2);
+    pLayout->addWidget(&editMinFrequency,     1, 1, 1, 2);
+    pLayout->addWidget(&editMaxFrequency,     2, 1, 1, 2);
+    pLayout->addWidget(&editPointsPerDecade,  3, 1, 1, 2);
+    pLayout->addWidget(&editFileName,         4, 1, 1, 1);
+    pLayout->addWidget(&fileButton,           4, 2, 1, 1);
+    pLayout->addWidget(&editExtraPoints,      5, 1, 1, 2);
+    pLayout->addWidget(&editThreshold,        6, 1, 1, 2);
+
+    setLayout(pLayout);
+}
+
+
+void
+FrequencyTab::setToolTips() {
+    comboMode.setToolTip(QString("How the measure frequencies are chosen"));
+    editMinFrequency.setToolTip(QString("Enter a value [20 - 1000000]"));
+    editMaxFrequency.setToolTip(QString("Enter a value [20 - 1000000]"));
+    editPointsPerDecade.setToolTip(QString("Enter a value [1 - 100]"));
+    editFileName.setToolTip(QString("A text file with the frequencies in Hz ('#' starts a comment)"));
+    editExtraPoints.setToolTip(QString("Max number of frequencies added by the Adaptive plan [0 - 500]"));
+    editThreshold.setToolTip(QString("Relative change of E\" or tan(d) between adjacent points that adds a frequency (0.0 - 10.0]"));
+}
+
+
+void
+FrequencyTab::connectSignals() {
+    connect(&comboMode, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(onModeChanged(int)));
+    connect(&editMinFrequency, SIGNAL(textChanged(QString)),
+            this, SLOT(onFrequencyTextChanged(QString)));
+    connect(&editMaxFrequency, SIGNAL(textChanged(QString)),
+            this, SLOT(onFrequencyTextChanged(QString)));
+    connect(&editPointsPerDecade, SIGNAL(textChanged(QString)),
+            this, SLOT(onPointsPerDecadeTextChanged(QString)));
+    connect(&editExtraPoints, SIGNAL(textChanged(QString)),
+            this, SLOT(onExtraPointsTextChanged(QString)));
+    connect(&editThreshold, SIGNAL(textChanged(QString)),
+            this, SLOT(onThresholdTextChanged(QString)));
+    connect(&fileButton, SIGNAL(clicked()),
+            this, SLOT(onFileButtonClicked()));
+}
+
+
+void
+FrequencyTab::restoreSettings() {
+    QSettings settings;
+    // The default grid is close to the old fixed 48 frequencies table
+    comboMode.setCurrentIndex(settings.value("frequencyTabMode", FrequencyPlan::LOG_GRID).toInt());
+    editMinFrequency.setText(settings.value("frequencyTabMinFrequency", "20").toString());
+    editMaxFrequency.setText(settings.value("frequencyTabMaxFrequency", "1000000").toString());
+    editPointsPerDecade.setText(settings.value("frequencyTabPointsPerDecade", "10").toString());
+    editFileName.setText(settings.value("frequencyTabFileName", "").toString());
+    editExtraPoints.setText(settings.value("frequencyTabExtraPoints", "30").toString());
+    editThreshold.setText(settings.value("frequencyTabThreshold", "0.15").toString());
+    onModeChanged(comboMode.currentIndex());
+}
+
+
+void
+FrequencyTab::saveSettings() {
+    QSettings settings;
+    settings.setValue("frequencyTabMode", comboMode.currentIndex());
+    settings.setValue("frequencyTabMinFrequency", editMinFrequency.text());
+    settings.setValue("frequencyTabMaxFrequency", editMaxFrequency.text());
+    settings.setValue("frequencyTabPointsPerDecade", editPointsPerDecade.text());
+    settings.setValue("frequencyTabFileName", editFileName.text());
+    settings.setValue("frequencyTabExtraPoints", editExtraPoints.text());
+    settings.setValue("frequencyTabThreshold", editThreshold.text());
+}
+
+
+bool
+FrequencyTab::checkFrequencies() {
+    if(getMode() == FrequencyPlan::FILE_LIST) {
+        QString sError;
+        if(FrequencyPlan::loadFile(getFileName(), &sError).isEmpty()) {
+            QMessageBox::critical(this,
+                                  "Error in Frequencies File",
+                                  sError);
+            return false;
+        }
+        return true;
+    }
+    if((getMinFrequency() < 20.0) || (getMaxFrequency() > 1.0e6) ||
+       (getMinFrequency() > getMaxFrequency()))
+    {
+        QMessageBox::critical(this,
+                              "Error in Frequency Range",
+                              QString("Enter a range between 20Hz and 1MHz"));
+        return false;
+    }
+    return true;
+}
+
+
+int
+FrequencyTab::getMode() {
+    return comboMode.currentIndex();
+}
+
+
+double
+FrequencyTab::getMinFrequency() {
+    return editMinFrequency.text().toDouble();
+}
+
+
+double
+FrequencyTab::getMaxFrequency() {
+    return editMaxFrequency.text().toDouble();
+}
+
+
+int
+FrequencyTab::getPointsPerDecade() {
+    return editPointsPerDecade.text().toInt();
+}
+
+
+QString
+FrequencyTab::getFileName() {
+    return editFileName.text();
+}
+
+
+int
+FrequencyTab::getExtraPoints() {
+    return editExtraPoints.text().toInt();
+}
+
+
+double
+FrequencyTab::getThreshold() {
+    return editThreshold.text().toDouble();
+}
+
+
+void
+FrequencyTab::onModeChanged(int iMode) {
+    bool bFile = (iMode == FrequencyPlan::FILE_LIST);
+    editMinFrequency.setEnabled(!bFile);
+    editMaxFrequency.setEnabled(!bFile);
+    editPointsPerDecade.setEnabled(!bFile);
+    editFileName.setEnabled(bFile);
+    fileButton.setEnabled(bFile);
+    editExtraPoints.setEnabled(iMode == FrequencyPlan::ADAPTIVE);
+    editThreshold.setEnabled(iMode == FrequencyPlan::ADAPTIVE);
+}
+
+
+void
+FrequencyTab::onFrequencyTextChanged(QString sValue) {
+    QLineEdit* pEdit = qobject_cast<QLineEdit*>(sender());
+    if(!pEdit)
+        return;
+    double dValue = sValue.toDouble();
+    if(dValue >= 20.0 && dValue <= 1.0e6) {
+        pEdit->setStyleSheet(sNormalStyle);
+    }
+    else {
+        pEdit->setStyleSheet(sErrorStyle);
+    }
+}
+
+
+void
+FrequencyTab::onPointsPerDecadeTextChanged(QString sValue) {
+    int iValue = sValue.toInt();
+    if(iValue > 0 && iValue <= 100) {
+        editPointsPerDecade.setStyleSheet(sNormalStyle);
+    }
+    else {
+        editPointsPerDecade.setStyleSheet(sErrorStyle);
+    }
+}
+
+
+void
+FrequencyTab::onExtraPointsTextChanged(QString sValue) {
+    int iValue = sValue.toInt();
+    if(iValue >= 0 && iValue <= 500) {
+        editExtraPoints.setStyleSheet(sNormalStyle);
+    }
+    else {
+        editExtraPoints.setStyleSheet(sErrorStyle);
+    }
+}
+
+
+void
+FrequencyTab::onThresholdTextChanged(QString sValue) {
+    double dValue = sValue.toDouble();
+    if(dValue > 0.0 && dValue <= 10.0) {
+        editThreshold.setStyleSheet(sNormalStyle);
+    }
+    else {
+        editThreshold.setStyleSheet(sErrorStyle);
+    }
+}
+
+
+void
+FrequencyTab::onFileButtonClicked() {
+    QString sFileName = QFileDialog::getOpenFileName(this,
+                                                     "Frequencies File",
+                                                     QFileInfo(editFileName.text()).absolutePath(),
+                                                     "Text Files (*.txt *.dat);;All Files (*)");
+    if(!sFileName.isEmpty())
+        editFileName.setText(sFileName);
+}
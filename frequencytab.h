@@ -0,0 +1,73 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QObject>
+#include <QWidget>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QComboBox>
+
+
+class FrequencyTab : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit FrequencyTab(QWidget *parent = nullptr);
+    void     restoreSettings();
+    void     saveSettings();
+    bool     checkFrequencies();
+    int      getMode();
+    double   getMinFrequency();
+    double   getMaxFrequency();
+    int      getPointsPerDecade();
+    QString  getFileName();
+    int      getExtraPoints();
+    double   getThreshold();
+
+public slots:
+    void onModeChanged(int iMode);
+    void onFrequencyTextChanged(QString sValue);
+    void onPointsPerDecadeTextChanged(QString sValue);
+    void onExtraPointsTextChanged(QString sValue);
+    void onThresholdTextChanged(QString sValue);
+    void onFileButtonClicked();
+
+protected:
+    void initUI();
+    void setToolTips();
+    void connectSignals();
+
+private:
+    QComboBox   comboMode;
+    QLineEdit   editMinFrequency;
+    QLineEdit   editMaxFrequency;
+    QLineEdit   editPointsPerDecade;
+    QLineEdit   editFileName;
+    QPushButton fileButton;
+    QLineEdit   editExtraPoints;
+    QLineEdit   editThreshold;
+    // QLineEdit styles
+    QString sNormalStyle;
+    QString sErrorStyle;
+};
@@ -3,20 +3,95 @@
 
 GpibDevice::GpibDevice(int gpio, int address, QObject *parent)
     : QObject(parent)
+    , pTransport(GpibTransport::instance())
     , gpibNumber(gpio)
     , gpibAddress(address)
     , gpibId(-1)
+    , bStopIo(false)
+    , abortCount(0)
+    , commandAbortCount(0)
 {
-    pollInterval = 300; // in ms
+    // Every GPIB transaction is blocking (up to the device timeout)
+    // so they are executed by a dedicated thread, leaving the
+    // GUI event loop free. Results come back as (queued) signals.
+    pIoThread = QThread::create([this]() { ioLoop(); });
+    pIoThread->setObjectName(QString("GPIB%1@%2").arg(gpio).arg(address));
+    pIoThread->start();
+}
+
+
+GpibDevice::~GpibDevice() {
+    stopIoThread();
+}
+
+
+// Enqueue a command for the I/O thread. It is safe to call
+// from any thread and returns immediately.
+void
+GpibDevice::post(std::function<void()> command) {
+    QMutexLocker locker(&queueMutex);
+    int iAbortCount = abortCount.loadAcquire();
+    commandQueue.enqueue([this, iAbortCount, command]() {
+        commandAbortCount = iAbortCount;
+        command();
+    });
+    queueNotEmpty.wakeOne();
+}
+
+
+// Discard the commands not yet started and interrupt the wait
+// for a Service Request (i.e. when a measure is stopped).
+// Commands posted afterwards are not affected.
+void
+GpibDevice::clearQueue() {
+    QMutexLocker locker(&queueMutex);
+    commandQueue.clear();
+    abortCount.ref();
+}
+
+
+// Must be called by the derived classes destructors before releasing
+// the resources the queued commands could still be using.
+void
+GpibDevice::stopIoThread() {
+    if(!pIoThread)
+        return;
+    queueMutex.lock();
+    bStopIo = true;
+    commandQueue.clear();
+    abortCount.ref();
+    queueNotEmpty.wakeAll();
+    queueMutex.unlock();
+    pIoThread->wait();
+    delete pIoThread;
+    pIoThread = nullptr;
+}
+
+
+void
+GpibDevice::ioLoop() {
+    std::function<void()> command;
+    forever {
+        queueMutex.lock();
+        while(commandQueue.isEmpty() && !bStopIo)
+            queueNotEmpty.wait(&queueMutex);
+        if(bStopIo) {
+            queueMutex.unlock();
+            return;
+        }
+        command = commandQueue.dequeue();
+        queueMutex.unlock();
+        command();
+    }
 }
 
 
 bool
 GpibDevice::isGpibError(QString sErrorString) {
-    if((ThreadIbsta() & ERR) ||
-       (ThreadIbsta() & TIMO))
+    if((pTransport->status() & ERR) ||
+       (pTransport->status() & TIMO))
     {
-        QString sError = ErrMsg(ThreadIbsta(), ThreadIberr(), ThreadIbcnt());
+        QString sError = ErrMsg(pTransport->status(), pTransport->error(), pTransport->count());
         emit aMessage(sErrorString + QString("\n") + sError);
         return true;
     }
@@ -72,9 +147,9 @@ GpibDevice::ErrMsg(int sta, int err, long cntl) {
 
 uint
 GpibDevice::gpibWrite(int ud, QString sCmd) {
-    ibwrt(ud, sCmd.toUtf8().constData(), sCmd.length());
+    pTransport->write(ud, sCmd.toUtf8().constData(), sCmd.length());
     isGpibError("GPIB Writing Error Writing");
-    return uint(ThreadIbsta());
+    return uint(pTransport->status());
 }
 
 
@@ -82,16 +157,102 @@ QString
 GpibDevice::gpibRead(int ud) {
     QString sString;
     do {
-        ibrd(ud, readBuf, sizeof(readBuf)-1);
+        pTransport->read(ud, readBuf, sizeof(readBuf)-1);
         if(isGpibError("GPIB Reading Error"))
             return QString();
-        readBuf[ThreadIbcnt()] = 0;
+        readBuf[pTransport->count()] = 0;
         sString += QString(readBuf);
-    } while(ThreadIbcnt() == sizeof(readBuf)-1);
+    } while(pTransport->count() == sizeof(readBuf)-1);
     return sString;
 }
 
 
+// Blocks the I/O thread until the device asserts SRQ (returns true)
+// or the queue is cleared (returns false). The Status Byte is read
+// to clear the request. The wait is split in slices of 1s to notice
+// the abort requests.
+bool
+GpibDevice::waitSrq() {
+    bool bSrq = false;
+    pTransport->setTimeout(gpibId, T1s);
+    while(abortCount.loadAcquire() == commandAbortCount) {
+        int iStatus = pTransport->wait(gpibId, RQS|TIMO);
+        if(iStatus & ERR) {
+            isGpibError(QString(Q_FUNC_INFO) + "ibwait() Error");
+            break;
+        }
+        if(iStatus & RQS) {
+            pTransport->serialPoll(gpibId, &spollByte);
+            bSrq = true;
+            break;
+        }
+    }
+    pTransport->setTimeout(gpibId, T30s);
+    return bSrq;
+}
+
+
+// Appends a command to the batch that will be sent by batchFlush().
+void
+GpibDevice::batchAdd(QString sCmd) {
+    sCmd = sCmd.trimmed();
+    if(!sCmd.isEmpty())
+        batchCommands.append(sCmd);
+}
+
+
+// Sends all the batched commands as a single program message, i.e.
+// "*CLS;:TRIG:SOUR BUS;:INIT:CONT OFF\r\n". Each header is rooted
+// with ':' since after a ';' the parser would otherwise look for it
+// in the subsystem of the previous one (common commands are allowed
+// anywhere). When bCheckErrors is true the message ends with a single
+// SYST:ERR? instead of an error check for each command.
+// Returns true if nothing has been sent.
+bool
+GpibDevice::batchFlush(bool bCheckErrors) {
+    if(batchCommands.isEmpty())
+        return true;
+    sCommand.clear();
+    for(int i=0; i<batchCommands.count(); i++) {
+        const QString& sCmd = batchCommands.at(i);
+        if(i > 0)
+            sCommand += ";";
+        if((i > 0) && !sCmd.startsWith('*') && !sCmd.startsWith(':'))
+            sCommand += ":";
+        sCommand += sCmd;
+    }
+    batchCommands.clear();
+    if(bCheckErrors)
+        sCommand += ";:SYST:ERR?";
+    sCommand += "\r\n";
+    gpibWrite(gpibId, sCommand);
+    if(isGpibError(QString(Q_FUNC_INFO) + sCommand))
+        return false;
+    if(!bCheckErrors)
+        return true;
+    // <error number>,"<error message>"
+    sResponse = gpibRead(gpibId);
+    if(isGpibError(QString(Q_FUNC_INFO) + sCommand))
+        return false;
+    if(sResponse.section(',', 0, 0).trimmed().toInt() != 0) {
+        emit aMessage(QString(Q_FUNC_INFO) + sCommand + QString("\n") + sResponse.trimmed());
+        return false;
+    }
+    return true;
+}
+
+
+// Reads a binary response into readBuf without any conversion.
+// Returns the number of bytes read or -1 on error.
+int
+GpibDevice::gpibReadBinary(int ud) {
+    pTransport->read(ud, readBuf, sizeof(readBuf)-1);
+    if(isGpibError("GPIB Reading Error"))
+        return -1;
+    return int(pTransport->count());
+}
+
+
 int
 GpibDevice::init() {
     return NO_ERROR;
@@ -110,15 +271,3 @@ GpibDevice::onGpibCallback(int LocalUd, unsigned long LocalIbsta, unsigned long
 void
 GpibDevice::checkNotify() {
 }
-
-
-void
-GpibDevice::setPollInterval(int interval) {
-    pollInterval = interval;
-}
-
-
-int
-GpibDevice::getPollInterval() {
-    return pollInterval;
-}
@@ -20,8 +20,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QtGlobal>
 #include <QObject>
-#include <QTimer>
-#include <gpib/ib.h>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QAtomicInt>
+#include <QStringList>
+#include <functional>
+
+#include "gpibtransport.h"
 
 
 class GpibDevice : public QObject
@@ -29,16 +36,23 @@ class GpibDevice : public QObject
     Q_OBJECT
 public:
     explicit      GpibDevice(int gpio, int address, QObject *parent = Q_NULLPTR);
+    virtual       ~GpibDevice();
     virtual int    init();
     virtual void   onGpibCallback(int ud, unsigned long ibsta, unsigned long iberr, long ibcntl);
-    void           setPollInterval(int interval);
-    int            getPollInterval();
+    void           post(std::function<void()> command);
+    virtual void   clearQueue();
 
 protected:
+    void    stopIoThread();
+    void    ioLoop();
     uint    gpibWrite(int ud, QString sCmd);
     QString gpibRead(int ud);
+    int     gpibReadBinary(int ud);
     QString ErrMsg(int sta, int err, long cntl);
     bool    isGpibError(QString sErrorString);
+    bool    waitSrq();
+    void    batchAdd(QString sCmd);
+    bool    batchFlush(bool bCheckErrors = true);
 
 signals:
     void    aMessage(QString sMessage);
@@ -52,14 +66,26 @@ public:
     const int NO_ERROR = 0;
 
 protected:
+    GpibTransport* pTransport;
     QString sCommand;
     QString sResponse;
-    QTimer  pollTimer;
-    int     pollInterval;
     int     gpibNumber;
     int     gpibAddress;
     int     gpibId;
     char    spollByte;
     int     iMask;
     char    readBuf[2001];
+
+private:
+    // All the bus traffic is executed, in order, by the I/O thread
+    QThread*                          pIoThread;
+    QMutex                            queueMutex;
+    QWaitCondition                    queueNotEmpty;
+    QQueue<std::function<void()>>     commandQueue;
+    bool                              bStopIo;
+    // Incremented by clearQueue() to interrupt waitSrq()
+    QAtomicInt                        abortCount;
+    int                               commandAbortCount;
+    // Commands waiting to be sent as a single program message
+    QStringList                       batchCommands;
 };
@@ -0,0 +1,217 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "gpibtransport.h"
+
+
+GpibTransport* GpibTransport::pTransport = nullptr;
+
+
+GpibTransport::~GpibTransport() {
+}
+
+
+// The transport used by all the GpibDevices. If none has been set
+// the real bus is used.
+GpibTransport*
+GpibTransport::instance() {
+    if(!pTransport)
+        pTransport = new LinuxGpibTransport();
+    return pTransport;
+}
+
+
+// Must be called before creating any GpibDevice
+void
+GpibTransport::setInstance(GpibTransport* pNewTransport) {
+    if(pTransport)
+        delete pTransport;
+    pTransport = pNewTransport;
+}
+
+
+// The *IDN? answer of the instrument at address, without any bus
+// clear or scan. Returns an empty string on error.
+QString
+GpibTransport::queryIdn(int board, int address) {
+    QByteArray command("*IDN?");
+    char readBuf[257];
+    send(board, address, command.constData(), command.length());
+    if(status() & ERR)
+        return QString();
+    receive(board, address, readBuf, 256);
+    if(status() & ERR)
+        return QString();
+    readBuf[count()] = '\0';
+    return QString(readBuf).trimmed();
+}
+
+
+// Clears the bus and identifies all the listeners.
+// Returns the *IDN? answers by address.
+QMap<int, QString>
+GpibTransport::scanBus(int board, QString* pErrorString) {
+    QMap<int, QString> instruments;
+    interfaceClear(board);
+    if(status() & ERR) {
+        if(pErrorString) *pErrorString = QString("SendIFC() Error: Is the GPIB Interface connected ?");
+        return instruments;
+    }
+    // The Universal Device Clear (DCL)
+    // message is sent to all the devices on the bus
+    clearAllDevices(board);
+    if(status() & ERR) {
+        if(pErrorString) *pErrorString = QString("DevClearList() failed");
+        return instruments;
+    }
+    QVector<int> listeners;
+    findListeners(board, listeners);
+    if(status() & ERR) {
+        if(pErrorString) *pErrorString = QString("FindLstn() failed");
+        return instruments;
+    }
+    for(int i=0; i<listeners.count(); i++) {
+        QString sIdn = queryIdn(board, listeners.at(i));
+        if(!sIdn.isEmpty())
+            instruments.insert(listeners.at(i), sIdn);
+    }
+    if(instruments.isEmpty() && pErrorString)
+        *pErrorString = QString("No Instruments found");
+    return instruments;
+}
+
+
+int
+LinuxGpibTransport::openDevice(int board, int address, int timeout) {
+    return ibdev(board, address, 0, timeout, 1, 0);
+}
+
+
+int
+LinuxGpibTransport::closeDevice(int ud) {
+    return ibonl(ud, 0);
+}
+
+
+int
+LinuxGpibTransport::isListener(int board, int address, short* pListen) {
+    return ibln(board, address, NO_SAD, pListen);
+}
+
+
+int
+LinuxGpibTransport::clearDevice(int ud) {
+    return ibclr(ud);
+}
+
+
+int
+LinuxGpibTransport::write(int ud, const char* pData, long count) {
+    return ibwrt(ud, pData, count);
+}
+
+
+int
+LinuxGpibTransport::read(int ud, char* pBuffer, long count) {
+    return ibrd(ud, pBuffer, count);
+}
+
+
+int
+LinuxGpibTransport::wait(int ud, int mask) {
+    return ibwait(ud, mask);
+}
+
+
+int
+LinuxGpibTransport::serialPoll(int ud, char* pStatusByte) {
+    return ibrsp(ud, pStatusByte);
+}
+
+
+int
+LinuxGpibTransport::setTimeout(int ud, int timeout) {
+    return ibtmo(ud, timeout);
+}
+
+
+void
+LinuxGpibTransport::interfaceClear(int board) {
+    SendIFC(board);
+}
+
+
+// If addrlist contains only the constant NOADDR,
+// the Universal Device Clear (DCL)
+// message is sent to all the devices on the bus
+void
+LinuxGpibTransport::clearAllDevices(int board) {
+    Addr4882_t addrlist;
+    addrlist = NOADDR;
+    DevClearList(board, &addrlist);
+}
+
+
+void
+LinuxGpibTransport::findListeners(int board, QVector<int>& addresses) {
+    Addr4882_t padlist[31];
+    Addr4882_t resultlist[31];
+    for(Addr4882_t i=0; i<30; i++) padlist[i] = i+1;
+    padlist[30] = NOADDR;
+    addresses.clear();
+    FindLstn(board, padlist, resultlist, 30);
+    if(ThreadIbsta() & ERR)
+        return;
+    int nDevices = ThreadIbcnt();
+    for(int i=0; i<nDevices; i++)
+        addresses.append(resultlist[i]);
+}
+
+
+void
+LinuxGpibTransport::send(int board, int address, const char* pData, long count) {
+    Send(board, Addr4882_t(address), pData, count, DABend);
+}
+
+
+void
+LinuxGpibTransport::receive(int board, int address, char* pBuffer, long count) {
+    Receive(board, Addr4882_t(address), pBuffer, count, STOPend);
+}
+
+
+int
+LinuxGpibTransport::status() {
+    return ThreadIbsta();
+}
+
+
+int
+LinuxGpibTransport::error() {
+    return ThreadIberr();
+}
+
+
+long
+LinuxGpibTransport::count() {
+    return ThreadIbcntl();
+}
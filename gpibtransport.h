@@ -0,0 +1,93 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QVector>
+#include <QString>
+#include <QMap>
+#include <gpib/ib.h>
+
+
+// The bus operations used by the GpibDevice classes. They have the
+// same meaning (and return the same status word) of the linux-gpib
+// functions they are named after, so the simulated instruments are
+// seen by the drivers exactly as the real ones.
+// status(), error() and count() are the ThreadIbsta(), ThreadIberr()
+// and ThreadIbcnt() of the last operation made by the calling thread.
+class GpibTransport
+{
+public:
+    virtual ~GpibTransport();
+
+    virtual int  openDevice(int board, int address, int timeout) = 0; // ibdev()
+    virtual int  closeDevice(int ud) = 0;                              // ibonl(ud, 0)
+    virtual int  isListener(int board, int address, short* pListen) = 0; // ibln()
+    virtual int  clearDevice(int ud) = 0;                              // ibclr()
+    virtual int  write(int ud, const char* pData, long count) = 0;     // ibwrt()
+    virtual int  read(int ud, char* pBuffer, long count) = 0;          // ibrd()
+    virtual int  wait(int ud, int mask) = 0;                           // ibwait()
+    virtual int  serialPoll(int ud, char* pStatusByte) = 0;            // ibrsp()
+    virtual int  setTimeout(int ud, int timeout) = 0;                  // ibtmo()
+    virtual void interfaceClear(int board) = 0;                        // SendIFC()
+    virtual void clearAllDevices(int board) = 0;                       // DevClearList(NOADDR)
+    virtual void findListeners(int board, QVector<int>& addresses) = 0;// FindLstn()
+    virtual void send(int board, int address, const char* pData, long count) = 0; // Send(DABend)
+    virtual void receive(int board, int address, char* pBuffer, long count) = 0;  // Receive(STOPend)
+    virtual int  status() = 0;
+    virtual int  error() = 0;
+    virtual long count() = 0;
+
+    QString queryIdn(int board, int address);
+    QMap<int, QString> scanBus(int board, QString* pErrorString);
+
+public:
+    static GpibTransport* instance();
+    static void setInstance(GpibTransport* pNewTransport);
+
+private:
+    static GpibTransport* pTransport;
+};
+
+
+// The real bus, through the linux-gpib library
+class LinuxGpibTransport : public GpibTransport
+{
+public:
+    int  openDevice(int board, int address, int timeout) override;
+    int  closeDevice(int ud) override;
+    int  isListener(int board, int address, short* pListen) override;
+    int  clearDevice(int ud) override;
+    int  write(int ud, const char* pData, long count) override;
+    int  read(int ud, char* pBuffer, long count) override;
+    int  wait(int ud, int mask) override;
+    int  serialPoll(int ud, char* pStatusByte) override;
+    int  setTimeout(int ud, int timeout) override;
+    void interfaceClear(int board) override;
+    void clearAllDevices(int board) override;
+    void findListeners(int board, QVector<int>& addresses) override;
+    void send(int board, int address, const char* pData, long count) override;
+    void receive(int board, int address, char* pBuffer, long count) override;
+    int  status() override;
+    int  error() override;
+    long count() override;
+};
@@ -22,147 +22,169 @@
 
 #include "hp4284a.h"
 
-#include <gpib/ib.h>
 #include <QThread>
+#include <QtEndian>
 #include <QDebug>
+#include <string.h>
 
 // The HP 4284A offers C-D measurements with a basic accuracy of
 // +/- 0.05%(C), +/- 0.0005(D) at all test frequencies with six digit
 // resolution
 
 
+// The SRQ is asserted through the Operation Status Register summary
+// bit. Only one of these bits is enabled at a time (STAT:OPER:ENAB)
+// so the source of the request is known without querying STAT:OPER?
 namespace hp4284a {
-    static int rearmMask;
     static int CORRECTION_COMPLETE_BIT = 1;
+    static int LIST_COMPLETE_BIT       = 8;
     static int MEASURE_COMPLETE_BIT    = 16;
 }
 
 
+// Values are sent MSB first in the REAL,64 format
+static double
+realValue(const char* pData) {
+    quint64 iValue = qFromBigEndian<quint64>(pData);
+    double dValue;
+    memcpy(&dValue, &iValue, sizeof(dValue));
+    return dValue;
+}
+
+
 Hp4284a::Hp4284a(int gpio, int address, QObject *parent)
     : GpibDevice(gpio, address, parent)
+    , bBinaryData(false)
+    , bInitialized(false)
+    , nListPoints(0)
 {
-    pollInterval = 500;
+    // The results are sent across threads by measurementComplete()
+    qRegisterMetaType<QVector<Hp4284aResult>>("QVector<Hp4284aResult>");
+    // After an error the instrument state is unknown. The connection
+    // is direct: the cache is cleared in the I/O thread.
+    connect(this, SIGNAL(mustExit()),
+            this, SLOT(invalidateState()),
+            Qt::DirectConnection);
 }
 
 
 Hp4284a::~Hp4284a() {
+    stopIoThread();
     if(gpibId != -1) {
-#if defined(Q_OS_LINUX)
-        pollTimer.stop();
-        pollTimer.disconnect();
-#else
-        ibnotify(gpibId, 0, NULL, NULL);// disable notification
-#endif
-        ibonl(gpibId, 0);// Disable hardware and software.
+        pTransport->closeDevice(gpibId);// Disable hardware and software.
     }
 }
 
 
+// Only the first initialization (or the first after an error) resets
+// the interface and sends all the settings. Otherwise the instrument
+// is already in a known state and only the changed settings are sent.
 int
 Hp4284a::init() {
-    gpibId = ibdev(gpibNumber, gpibAddress, 0, T30s, 1, 0);
+    if(bInitialized) {
+        if(!myInit())
+            return -1;
+        return NO_ERROR;
+    }
+    if(gpibId != -1) {
+        pTransport->closeDevice(gpibId);
+        gpibId = -1;
+    }
+    gpibId = pTransport->openDevice(gpibNumber, gpibAddress, T30s);
     if(gpibId < 0) {
-        QString sError = ErrMsg(ThreadIbsta(), ThreadIberr(), ThreadIbcntl());
+        QString sError = ErrMsg(pTransport->status(), pTransport->error(), pTransport->count());
         emit aMessage(Q_FUNC_INFO + sError);
+        emit mustExit();
         return GPIB_DEVICE_NOT_PRESENT;
     }
     short listen;
-    ibln(gpibNumber, gpibAddress, NO_SAD, &listen);
-    if(isGpibError(QString(Q_FUNC_INFO) + "HP 4284a Not Respondig"))
+    pTransport->isListener(gpibNumber, gpibAddress, &listen);
+    if(isGpibError(QString(Q_FUNC_INFO) + "HP 4284a Not Respondig")) {
+        emit mustExit();
         return GPIB_DEVICE_NOT_PRESENT;
+    }
     if(listen == 0) {
-        ibonl(gpibId, 0);
+        pTransport->closeDevice(gpibId);
+        gpibId = -1;
         emit aMessage("Nolistener at Addr");
+        emit mustExit();
         return GPIB_DEVICE_NOT_PRESENT;
     }
-    ibclr(gpibId);
-    QThread::sleep(1);
+    pTransport->clearDevice(gpibId);
+    invalidateState();
+    QThread::sleep(1); // We are in the I/O thread: the GUI is not blocked
     if(!myInit())
         return -1;
+    bInitialized = true;
     return NO_ERROR;
 }
 
 
 bool
 Hp4284a::myInit() {
-    sCommand  = "*sre 0\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "*cls\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "FUNC:IMP:TYPE CPD\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "FUNC:IMP:RANG:AUTO ON\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "AMPL:ALC ON\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "DISP:PAGE MEAS\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "APER LONG, 7";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "BIAS:STAT OFF\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "TRIG:SOUR INT\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "INIT:CONT ON\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "FORM:DATA ASC\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "CORR:OPEN:STATE ON\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "CORR:SHORT:STATE ON\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "CORR:LOAD:STATE OFF\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "CORR:LENG 1\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
+    // *CLS first: it would also clear the errors of the previous commands
+    sendCommand("*CLS");
+    // Restores what the query and correction sequences change
+    setParameter("*SRE", "0");
+    setParameter("FUNC:IMP:RANG:AUTO", "ON");
+    setParameter("AMPL:ALC", "ON");
+    setParameter("DISP:PAGE", "MEAS");
+    setParameter("BIAS:STAT", "OFF");
+    setParameter("TRIG:SOUR", "INT");
+    setParameter("INIT:CONT", "ON");
+    setParameter("CORR:LOAD:STATE", "OFF");
+    setParameter("CORR:LENG", "1");
+    // The settings with a setter only the first time: later the sweeps
+    // choose them and they would be switched back and forth
+    if(!bInitialized) {
+        setParameter("FUNC:IMP:TYPE", "CPD");
+        setParameter("APER", "LONG,7");
+        setParameter("FORM:DATA", "ASC");
+        setParameter("CORR:OPEN:STATE", "ON");
+        setParameter("CORR:SHORT:STATE", "ON");
+        bBinaryData = false;
+    }
+    return flushCommands();
+}
+
+
+// Any command resetting the instrument settings (i.e. *RST or a
+// Device Clear) must be followed by a call to this function.
+void
+Hp4284a::invalidateState() {
+    settingsCache.clear();
+    bInitialized = false;
+}
+
+
+// Adds "sHeader sValue" to the command batch only if the instrument
+// setting is not already known to have that value. The cache is
+// updated in advance: if the batch fails mustExit() invalidates it.
+void
+Hp4284a::setParameter(QString sHeader, QString sValue) {
+    if(settingsCache.value(sHeader) == sValue)
+        return;
+    batchAdd(QString("%1 %2").arg(sHeader, sValue));
+    settingsCache.insert(sHeader, sValue);
+}
+
+
+// Adds the commands that are actions and not settings (i.e. *CLS)
+void
+Hp4284a::sendCommand(QString sCmd) {
+    batchAdd(sCmd);
+}
+
+
+// Sends the pending commands as a single program message. The setters
+// only add their commands to it: they are sent by the next action (i.e.
+// enableListSweep(), openCorrection()) or by calling this function.
+bool
+Hp4284a::flushCommands(bool bCheckErrors) {
+    if(!batchFlush(bCheckErrors)) {
         emit mustExit();
+        return false;
     }
-    pollTimer.start(pollInterval);
-    connect(&pollTimer, SIGNAL(timeout()),
-            this, SLOT(checkNotify()));
     return true;
 }
 
@@ -184,237 +206,310 @@ Hp4284a::getValues() {
 
 bool
 Hp4284a::openCorrection() {
-    sCommand = "*CLS\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "STAT:OPER:ENAB 1\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "*SRE 128\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "CORR:OPEN\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
+    sendCommand("*CLS");
+    setParameter("STAT:OPER:ENAB", QString::number(hp4284a::CORRECTION_COMPLETE_BIT));
+    setParameter("*SRE", "128");
+    sendCommand("CORR:OPEN");
+    if(!flushCommands())
+        return false;
+    if(waitSrq())
+        emit correctionDone();
     return true;
 }
 
 
 bool
 Hp4284a::shortCorrection() {
-    sCommand = "*CLS\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "AMPL:ALC OFF\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "STAT:OPER:ENAB 1\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "*SRE 128\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "CORR:SHORT\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
+    sendCommand("*CLS");
+    setParameter("AMPL:ALC", "OFF");
+    setParameter("STAT:OPER:ENAB", QString::number(hp4284a::CORRECTION_COMPLETE_BIT));
+    setParameter("*SRE", "128");
+    sendCommand("CORR:SHORT");
+    if(!flushCommands())
+        return false;
+    if(waitSrq())
+        emit correctionDone();
     return true;
 }
 
 
 bool
 Hp4284a::closeCorrection() {
-    sCommand = "STAT:OPER:ENAB 0\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "*CLS\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "*SRE 0\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    return true;
+    sendCommand("*CLS");
+    setParameter("STAT:OPER:ENAB", "0");
+    setParameter("*SRE", "0");
+    return flushCommands();
 }
 
 
 bool
 Hp4284a::enableQuery() {
-    sCommand = "*CLS\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "TRIG:SOUR BUS\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand  = "INIT:CONT OFF\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "STAT:OPER:ENAB 16\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "*SRE 128\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    return true;
+    sendCommand("*CLS");
+    setParameter("TRIG:SOUR", "BUS");
+    setParameter("INIT:CONT", "OFF");
+    setParameter("STAT:OPER:ENAB", QString::number(hp4284a::MEASURE_COMPLETE_BIT));
+    setParameter("*SRE", "128");
+    return flushCommands();
 }
 
 
+// Triggers a measurement and waits for its completion SRQ, then
+// the values are fetched and sent with measurementComplete().
+// The *CLS clears the Operation Status event register, otherwise
+// its summary bit would stay set and no new SRQ would be asserted.
 bool
 Hp4284a::queryValues() {
-    sCommand = "TRIG\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
+    sendCommand("*CLS");
+    sendCommand("TRIG");
+    // No error query here: it would be answered during the measure
+    if(!flushCommands(false))
+        return false;
+    if(!waitSrq())
+        return false;
+    // <DATA A>,<DATA B>,<STATUS>
+    QVector<Hp4284aResult> results = fetchValues(3, 1);
+    if(results.isEmpty())
+        return false;
+    emit measurementComplete(results);
     return true;
 }
 
 
+// In the list sweep mode (Sequential) a single trigger measures all
+// the list points and a single FETCH? returns all the results.
 bool
-Hp4284a::disableQuery() {
-    sCommand = "STAT:OPER:ENAB 0\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "*SRE 0\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    sCommand = "*CLS\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
+Hp4284a::enableListSweep() {
+    sendCommand("*CLS");
+    // The list sweep is performed only when its page is displayed
+    setParameter("DISP:PAGE", "LIST");
+    setParameter("LIST:MODE", "SEQ");
+    setParameter("TRIG:SOUR", "BUS");
+    setParameter("INIT:CONT", "ON");
+    setParameter("STAT:OPER:ENAB", QString::number(hp4284a::LIST_COMPLETE_BIT));
+    setParameter("*SRE", "128");
+    return flushCommands();
+}
+
+
+bool
+Hp4284a::setListFrequencies(QVector<double> listFrequencies) {
+    if(listFrequencies.isEmpty() || (listFrequencies.count() > MAX_LIST_POINTS))
+        return false;
+    QStringList sFrequencies;
+    for(int i=0; i<listFrequencies.count(); i++)
+        sFrequencies.append(QString::number(listFrequencies.at(i), 'g', 7));
+    setParameter("LIST:FREQ", sFrequencies.join(","));
+    nListPoints = listFrequencies.count();
+    return true;
+}
+
+
+// Triggers the whole list sweep and waits for its completion SRQ.
+// The results of all the points are sent with measurementComplete(),
+// only if there is one for each point of the list.
+bool
+Hp4284a::queryListValues() {
+    sendCommand("*CLS");
+    sendCommand("TRIG");
+    // No error query here: it would be answered during the measure
+    if(!flushCommands(false))
+        return false;
+    if(!waitSrq())
+        return false;
+    // <DATA A>,<DATA B>,<STATUS>,<IN/OUT> for each list point
+    QVector<Hp4284aResult> results = fetchValues(4, nListPoints);
+    if(results.isEmpty())
+        return false;
+    emit measurementComplete(results);
+    return true;
+}
+
+
+// The measurement data can be transferred as ASCII strings or as
+// 64 bits binary values: 8 bytes per value instead of 13 and no
+// string conversions at all. If the setting fails mustExit() forces
+// a new initialization.
+bool
+Hp4284a::setBinaryTransfer(bool bBinary) {
+    setParameter("FORM:DATA", bBinary ? "REAL,64" : "ASC");
+    bBinaryData = bBinary;
+    return true;
+}
+
+
+bool
+Hp4284a::isBinaryTransfer() {
+    return bBinaryData;
+}
+
+
+// Returns exactly nPoints results or (after a mustExit()) none at all:
+// a partial reply would leave holes in the spectrum.
+QVector<Hp4284aResult>
+Hp4284a::fetchValues(int nFields, int nPoints) {
+    QVector<Hp4284aResult> results;
+    if(bBinaryData) {
+        sCommand = "FETCH?\r\n";
+        gpibWrite(gpibId, sCommand);
+        if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
+            emit mustExit();
+            return results;
+        }
+        int nBytes = gpibReadBinary(gpibId);
+        if(nBytes < 0) {
+            emit mustExit();
+            return results;
+        }
+        // The block size is checked there, against nPoints
+        return parseBinaryValues(nBytes, nFields, nPoints);
     }
-    sCommand  = "TRIG:SOUR INT\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
+    results = parseValues(getValues(), nFields);
+    if(results.count() != nPoints) {
+        emit aMessage(QString(Q_FUNC_INFO) +
+                      QString("%1 values instead of %2").arg(results.count()).arg(nPoints));
         emit mustExit();
+        results.clear();
     }
-    sCommand  = "INIT:CONT ON\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
+    return results;
+}
+
+
+QVector<Hp4284aResult>
+Hp4284a::parseValues(QString sValues, int nFields) {
+    QVector<Hp4284aResult> results;
+    QStringList sFields = sValues.split(",");
+    for(int i=0; i+nFields<=sFields.count(); i+=nFields) {
+        Hp4284aResult result;
+        result.primary   = sFields.at(i).trimmed().toDouble();
+        result.secondary = sFields.at(i+1).trimmed().toDouble();
+        result.status    = sFields.at(i+2).trimmed().toInt();
+        result.bin       = (nFields > 3) ? sFields.at(i+3).trimmed().toInt() : 0;
+        results.append(result);
     }
-    return true;
+    return results;
+}
+
+
+// The binary data are read directly from readBuf. They are sent as an
+// IEEE 488.2 indefinite length block: "#0" followed by the values and
+// terminated by NL^END. Anything but nPoints complete points is an error.
+QVector<Hp4284aResult>
+Hp4284a::parseBinaryValues(int nBytes, int nFields, int nPoints) {
+    QVector<Hp4284aResult> results;
+    if((nBytes < 2) || (readBuf[0] != '#') || (readBuf[1] != '0')) {
+        emit aMessage(QString(Q_FUNC_INFO) + "Unexpected binary data header");
+        emit mustExit();
+        return results;
+    }
+    const int pointSize = nFields * int(sizeof(double));
+    const int blockSize = 2 + nPoints*pointSize + 1;
+    if((nBytes != blockSize) || (readBuf[nBytes-1] != '\n')) {
+        emit aMessage(QString(Q_FUNC_INFO) +
+                      QString("Binary data block of %1 bytes instead of %2").arg(nBytes).arg(blockSize));
+        emit mustExit();
+        return results;
+    }
+    const char* pData = readBuf + 2;
+    results.reserve(nPoints);
+    for(int i=0; i<nPoints; i++) {
+        Hp4284aResult result;
+        result.primary   = realValue(pData);
+        result.secondary = realValue(pData+8);
+        result.status    = int(realValue(pData+16));
+        result.bin       = (nFields > 3) ? int(realValue(pData+24)) : 0;
+        results.append(result);
+        pData += pointSize;
+    }
+    return results;
+}
+
+
+bool
+Hp4284a::disableQuery() {
+    sendCommand("*CLS");
+    setParameter("STAT:OPER:ENAB", "0");
+    setParameter("*SRE", "0");
+    setParameter("TRIG:SOUR", "INT");
+    setParameter("INIT:CONT", "ON");
+    setParameter("DISP:PAGE", "MEAS");
+    return flushCommands();
 }
 
 
 bool
 Hp4284a::setMode(int Mode) {
     if((Mode < CPD) || (Mode > YTR)) return false;
-    sCommand  = "FUNC:IMP:TYPE ";
+    QString sMode;
     switch (Mode) {
     case CPD:
-        sCommand += "CPD";
+        sMode = "CPD";
         break;
     case LPRP:
-        sCommand += "LPRP";
+        sMode = "LPRP";
         break;
     case CPQ:
-        sCommand += "CPQ";
+        sMode = "CPQ";
         break;
     case LSD:
-        sCommand += "LSD";
+        sMode = "LSD";
         break;
     case CPG:
-        sCommand += "CPG";
+        sMode = "CPG";
         break;
     case LSQ:
-        sCommand += "LSQ";
+        sMode = "LSQ";
         break;
     case CPRP:
-        sCommand += "CPRP";
+        sMode = "CPRP";
         break;
     case LSRS:
-        sCommand += "LSRS";
+        sMode = "LSRS";
         break;
     case CSD:
-        sCommand += "CPD";
+        sMode = "CPD";
         break;
     case RX:
-        sCommand += "RX";
+        sMode = "RX";
         break;
     case CSQ:
-        sCommand += "CSQ";
+        sMode = "CSQ";
         break;
     case ZTD:
-        sCommand += "ZTD";
+        sMode = "ZTD";
         break;
     case CSRS:
-        sCommand += "CSRS";
+        sMode = "CSRS";
         break;
     case ZTR:
-        sCommand += "ZTR";
+        sMode = "ZTR";
         break;
     case LPQ:
-        sCommand += "LPQ";
+        sMode = "LPQ";
         break;
     case GB:
-        sCommand += "GB";
+        sMode = "GB";
         break;
     case LPD:
-        sCommand += "LPD";
+        sMode = "LPD";
         break;
     case YTD:
-        sCommand += "YTD";
+        sMode = "YTD";
         break;
     case LPG:
-        sCommand += "LPG";
+        sMode = "LPG";
         break;
     case YTR:
-        sCommand += "YTR";
+        sMode = "YTR";
         break;
     }
-    sCommand += "\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
+    setParameter("FUNC:IMP:TYPE", sMode);
     return true;
 }
 
 
 bool
 Hp4284a::setFrequency(double Frequency) {
-    sCommand = QString("FREQ %1 HZ\r\n").arg(Frequency);
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
+    setParameter("FREQ", QString("%1 HZ").arg(Frequency));
     return true;
 }
 
@@ -436,39 +531,32 @@ Hp4284a::getFrequency() {
 
 bool
 Hp4284a::setOpenCorrection(bool bOn) {
-    if(bOn)
-        sCommand  = "CORR:OPEN:STATE ON\r\n";
-    else
-        sCommand  = "CORR:OPEN:STATE OFF\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
+    setParameter("CORR:OPEN:STATE", bOn ? "ON" : "OFF");
     return true;
 }
 
 
 bool
 Hp4284a::setShortCorrection(bool bOn) {
-    if(bOn)
-        sCommand  = "CORR:SHORT:STATE ON\r\n";
-    else
-        sCommand  = "CORR:SHORT:STATE OFF\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
+    setParameter("CORR:SHORT:STATE", bOn ? "ON" : "OFF");
+    return true;
+}
+
+
+// The delay between the trigger and the start of the measurement.
+// In list sweep mode it is inserted before each sweep point.
+bool
+Hp4284a::setTriggerDelay(double seconds) {
+    if((seconds < 0.0) || (seconds > 60.0))
+        return false;
+    setParameter("TRIG:DEL", QString("%1").arg(seconds));
     return true;
 }
 
 
 bool
 Hp4284a::setAmplitude(double amplitude) {
-    sCommand =QString("VOLT %1 V\r\n").arg(amplitude);
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
+    setParameter("VOLT", QString("%1 V").arg(amplitude));
     return true;
 }
 
@@ -488,14 +576,12 @@ Hp4284a::getAmpltude() {
 }
 
 
+// The number of measures averaged by the instrument [1 - 128]
 bool
 Hp4284a::setAverages(int nAvg) {
-    sCommand = QString("APER LONG, %1").arg(nAvg);
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
+    if((nAvg < 1) || (nAvg > 128))
         return false;
-    }
+    setParameter("APER", QString("LONG,%1").arg(nAvg));
     return true;
 }
 
@@ -516,64 +602,3 @@ Hp4284a::getAverages() {
     }
     return sResults.at(1).toInt();
 }
-
-
-bool
-Hp4284a::setPollInterval(int msPollInterval) {
-    if((msPollInterval >= 100) && (msPollInterval <= 1000)) {
-        pollInterval = msPollInterval;
-        if(pollTimer.isActive()) {
-            pollTimer.setInterval(pollInterval);
-            return true;
-        }
-    }
-    return false;
-}
-
-
-int
-Hp4284a::getPollInterval() {
-    return pollTimer.interval();
-}
-
-
-void
-Hp4284a::checkNotify() {
-    ibrsp(gpibId, &spollByte);
-    if(isGpibError(QString(Q_FUNC_INFO) + "ibrsp() Error"))
-        emit mustExit();
-    if(!(spollByte & 64))
-        return; // SRQ not enabled
-    onGpibCallback(gpibId, uint(ThreadIbsta()), uint(ThreadIberr()), ThreadIbcnt());
-}
-
-
-void
-Hp4284a::onGpibCallback(int LocalUd, unsigned long LocalIbsta, unsigned long LocalIberr, long LocalIbcntl) {
-    Q_UNUSED(LocalIbsta)
-    Q_UNUSED(LocalIbcntl)
-    spollByte = 0;
-    int iStatus = ibrsp(LocalUd, &spollByte);
-    if(iStatus & ERR) {
-        emit aMessage(QString(Q_FUNC_INFO) + QString("GPIB error %1").arg(LocalIberr));
-        emit aMessage(QString(Q_FUNC_INFO) + QString("ibrsp() returned: %1").arg(iStatus));
-        emit aMessage(QString(Q_FUNC_INFO) + QString("Serial Poll Response Byte %1").arg(spollByte));
-    }
-    sCommand = "STAT:OPER?\r\n";
-    gpibWrite(gpibId, sCommand);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    QString sResults = gpibRead(gpibId);
-    if(isGpibError(QString(Q_FUNC_INFO) + sCommand)) {
-        emit mustExit();
-    }
-    int iReg = sResults.toInt();
-    if(iReg & hp4284a::CORRECTION_COMPLETE_BIT) {
-        emit correctionDone();
-    } else if(iReg & hp4284a::MEASURE_COMPLETE_BIT) {
-        emit measurementComplete();
-    }
-    hp4284a::rearmMask = RQS;
-}
-
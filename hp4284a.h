@@ -24,10 +24,23 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QVector>
+#include <QHash>
+#include <QMetaType>
 
 #include "gpibdevice.h"
 
 
+// A single point of the values returned by FETCH?
+struct Hp4284aResult {
+    double primary;   // i.e. Cp for the Cp-D function
+    double secondary; // i.e. D  for the Cp-D function
+    int    status;    // 0 means a normal measurement
+    int    bin;       // BIN number or, for list sweeps, the IN/OUT flag
+};
+Q_DECLARE_METATYPE(Hp4284aResult)
+
+
 class Hp4284a : public GpibDevice
 {
     Q_OBJECT
@@ -42,7 +55,6 @@ public:
     bool    queryValues();
     bool    enableQuery();
     bool    closeCorrection();
-    void    onGpibCallback(int LocalUd, unsigned long LocalIbsta, unsigned long LocalIberr, long LocalIbcntl);
     bool    shortCorrection();
     bool    openCorrection();
     QString getValues();
@@ -52,18 +64,23 @@ public:
     double  getAmpltude();
     bool    setAverages(int nAvg);
     int     getAverages();
-    bool    setPollInterval(int msPollInterval);
-    int     getPollInterval();
     bool    setOpenCorrection(bool bOn);
     bool    setShortCorrection(bool bOn);
+    bool    setTriggerDelay(double seconds);
+    bool    enableListSweep();
+    bool    setListFrequencies(QVector<double> listFrequencies);
+    bool    queryListValues();
+    bool    setBinaryTransfer(bool bBinary);
+    bool    isBinaryTransfer();
+    bool    flushCommands(bool bCheckErrors = true);
 
 
 signals:
     void correctionDone();
-    void measurementComplete();
+    void measurementComplete(QVector<Hp4284aResult> results);
 
 public slots:
-    void checkNotify();
+    void invalidateState();
 
 public:
     static const int CPD  =  0; // Sets function to Cp-D
@@ -87,9 +104,21 @@ public:
     static const int LPG  = 18; // Sets function to Lp-G
     static const int YTR  = 19; // Sets function to Y-. (rad)
 
+    static const int MAX_LIST_POINTS = 10; // Sweep points per list
+
 protected:
     bool myInit();
+    void setParameter(QString sHeader, QString sValue);
+    void sendCommand(QString sCmd);
+    QVector<Hp4284aResult> fetchValues(int nFields, int nPoints);
+    QVector<Hp4284aResult> parseValues(QString sValues, int nFields);
+    QVector<Hp4284aResult> parseBinaryValues(int nBytes, int nFields, int nPoints);
 
 private:
+    bool bBinaryData;
+    bool bInitialized;
+    int  nListPoints; // Set by setListFrequencies()
+    // Last value sent for each setting, by command header
+    QHash<QString, QString> settingsCache;
 
 };
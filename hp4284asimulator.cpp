@@ -0,0 +1,939 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "hp4284asimulator.h"
+
+#include <QSettings>
+#include <QThread>
+#include <QRandomGenerator>
+#include <QRegExp>
+#include <QtEndian>
+#include <complex>
+#include <math.h>
+#include <string.h>
+
+
+// The status of the last operation, as ThreadIbsta() etc. are
+static thread_local int  simIbsta = 0;
+static thread_local int  simIberr = 0;
+static thread_local long simIbcnt = 0;
+
+
+// The ibtmo() timeout codes (TNONE, T10us ... T1000s) in us
+static const qint64 timeoutUs[] = {
+    0,
+    10LL, 30LL, 100LL, 300LL,
+    1000LL, 3000LL, 10000LL, 30000LL, 100000LL, 300000LL,
+    1000000LL, 3000000LL, 10000000LL, 30000000LL, 100000000LL, 300000000LL,
+    1000000000LL
+};
+
+
+// Long form -> short form of the SCPI mnemonics used
+static const QMap<QString, QString> shortForms = {
+    {"FUNCTION",   "FUNC"}, {"IMPEDANCE",  "IMP"},  {"RANGE",     "RANG"},
+    {"AMPLITUDE",  "AMPL"}, {"DISPLAY",    "DISP"}, {"APERTURE",  "APER"},
+    {"TRIGGER",    "TRIG"}, {"INITIATE",   "INIT"}, {"CONTINUOUS","CONT"},
+    {"FORMAT",     "FORM"}, {"CORRECTION", "CORR"}, {"LENGTH",    "LENG"},
+    {"STATUS",     "STAT"}, {"STATE",      "STAT"}, {"OPERATION", "OPER"},
+    {"ENABLE",     "ENAB"}, {"FREQUENCY",  "FREQ"}, {"VOLTAGE",   "VOLT"},
+    {"SOURCE",     "SOUR"}, {"DELAY",      "DEL"},  {"SYSTEM",    "SYST"},
+    {"ERROR",      "ERR"},  {"FETCH",      "FETC"}, {"EXECUTE",   "EXEC"},
+    {"EVENT",      "EVEN"}, {"CONDITION",  "COND"}, {"IMMEDIATE", "IMM"}
+};
+
+
+static double
+gaussian() {
+    double u1 = QRandomGenerator::global()->generateDouble();
+    double u2 = QRandomGenerator::global()->generateDouble();
+    if(u1 < 1.0e-300) u1 = 1.0e-300;
+    return sqrt(-2.0*log(u1)) * cos(2.0*M_PI*u2);
+}
+
+
+// Parses a numeric parameter with an optional unit suffix (i.e. "1 KHZ")
+static bool
+parseNumber(QString sValue, double* pValue) {
+    static const QVector<QPair<QString, double>> suffixes = {
+        {"MHZ", 1.0e6}, {"KHZ", 1.0e3}, {"HZ", 1.0},
+        {"MV", 1.0e-3}, {"V", 1.0},
+        {"MS", 1.0e-3}, {"S", 1.0}
+    };
+    QString sNumber = sValue.trimmed().toUpper();
+    double multiplier = 1.0;
+    for(int i=0; i<suffixes.count(); i++) {
+        if(sNumber.endsWith(suffixes.at(i).first)) {
+            sNumber.chop(suffixes.at(i).first.length());
+            multiplier = suffixes.at(i).second;
+            break;
+        }
+    }
+    bool bOk;
+    *pValue = sNumber.trimmed().toDouble(&bOk) * multiplier;
+    return bOk;
+}
+
+
+Hp4284aSimulator::Hp4284aSimulator(int board, QVector<int> addresses)
+    : boardNumber(board)
+    , nextUd(1)
+{
+    getSettings();
+    for(int i=0; i<addresses.count(); i++) {
+        Instrument* pInstrument = new Instrument;
+        pInstrument->address = addresses.at(i);
+        reset(pInstrument);
+        instruments.insert(addresses.at(i), pInstrument);
+    }
+    clock.start();
+}
+
+
+Hp4284aSimulator::~Hp4284aSimulator() {
+    qDeleteAll(instruments);
+}
+
+
+// The sample model can be changed through the application settings
+void
+Hp4284aSimulator::getSettings() {
+    QSettings settings;
+    model.epsInf   = settings.value("simulatorEpsInf",   "3.0").toDouble();
+    model.deltaEps = settings.value("simulatorDeltaEps", "10.0").toDouble();
+    model.tau      = settings.value("simulatorTau",      "1.0e-4").toDouble();
+    model.alpha    = settings.value("simulatorAlpha",    "0.8").toDouble();
+    model.beta     = settings.value("simulatorBeta",     "0.6").toDouble();
+    model.sigma    = settings.value("simulatorSigma",    "1.0e-9").toDouble();
+    model.c0       = settings.value("simulatorC0",       "10.0e-12").toDouble();
+    model.noise    = settings.value("simulatorNoise",    "1.0e-4").toDouble();
+    timeScale      = settings.value("simulatorTimeScale","1.0").toDouble();
+}
+
+
+void
+Hp4284aSimulator::setModel(DielectricModel newModel) {
+    QMutexLocker locker(&mutex);
+    model = newModel;
+}
+
+
+void
+Hp4284aSimulator::setTimeScale(double newTimeScale) {
+    QMutexLocker locker(&mutex);
+    timeScale = qMax(0.0, newTimeScale);
+}
+
+
+// The power on settings
+void
+Hp4284aSimulator::reset(Instrument* pInstrument) {
+    pInstrument->timeout        = T30s;
+    pInstrument->sFunction      = "CPD";
+    pInstrument->frequency      = 1.0e3;
+    pInstrument->voltage        = 1.0;
+    pInstrument->sAperture      = "MED";
+    pInstrument->averages       = 1;
+    pInstrument->triggerDelay   = 0.0;
+    pInstrument->sTriggerSource = "INT";
+    pInstrument->bContinuous    = true;
+    pInstrument->sDisplayPage   = "MEAS";
+    pInstrument->sListMode      = "SEQ";
+    pInstrument->listFrequencies.clear();
+    pInstrument->bBinary        = false;
+    pInstrument->otherSettings.clear();
+    pInstrument->sre            = 0;
+    pInstrument->operEnable     = 0;
+    pInstrument->operEvent      = 0;
+    pInstrument->bSummary       = false;
+    pInstrument->bSrq           = false;
+    pInstrument->errorQueue.clear();
+    pInstrument->outputQueue.clear();
+    pInstrument->bBusy          = false;
+    pInstrument->completionTime = 0;
+    pInstrument->pendingEvents  = 0;
+    pInstrument->pendingFrequencies.clear();
+    pInstrument->resultFrequencies.clear();
+}
+
+
+// Device Clear: the I/O buffers are cleared and the operation
+// in progress is aborted. The settings are not changed.
+void
+Hp4284aSimulator::deviceClear(Instrument* pInstrument) {
+    pInstrument->outputQueue.clear();
+    pInstrument->bBusy = false;
+    pInstrument->pendingEvents = 0;
+}
+
+
+qint64
+Hp4284aSimulator::now() {
+    return clock.nsecsElapsed() / 1000; // us
+}
+
+
+// Completes the operation in progress, if its time has come
+void
+Hp4284aSimulator::update(Instrument* pInstrument) {
+    if(!pInstrument->bBusy || (now() < pInstrument->completionTime))
+        return;
+    pInstrument->bBusy = false;
+    if(!pInstrument->pendingFrequencies.isEmpty())
+        pInstrument->resultFrequencies = pInstrument->pendingFrequencies;
+    pInstrument->operEvent |= pInstrument->pendingEvents;
+    pInstrument->pendingEvents = 0;
+    updateSrq(pInstrument);
+}
+
+
+// The Operation Status summary is the bit 7 of the Status Byte.
+// SRQ is asserted on its rising edge, if enabled by *SRE.
+void
+Hp4284aSimulator::updateSrq(Instrument* pInstrument) {
+    bool bSummary = (pInstrument->operEvent & pInstrument->operEnable) != 0;
+    if(bSummary && !pInstrument->bSummary && (pInstrument->sre & 128))
+        pInstrument->bSrq = true;
+    pInstrument->bSummary = bSummary;
+}
+
+
+void
+Hp4284aSimulator::addError(Instrument* pInstrument, QString sError) {
+    if(pInstrument->errorQueue.count() < 10)
+        pInstrument->errorQueue.append(sError);
+    else
+        pInstrument->errorQueue.last() = QString("-350,\"Queue overflow\"");
+}
+
+
+// The time needed to measure a single point (in us). The values at
+// high frequency are the ones of the manual; at low frequency the
+// integration time grows with the period of the test signal.
+double
+Hp4284aSimulator::measureTime(Instrument* pInstrument, double f) {
+    double baseTime, nPeriods;
+    if(pInstrument->sAperture == "SHOR") {
+        baseTime = 40.0e-3;
+        nPeriods = 2.0;
+    }
+    else if(pInstrument->sAperture == "LONG") {
+        baseTime = 830.0e-3;
+        nPeriods = 16.0;
+    }
+    else {
+        baseTime = 190.0e-3;
+        nPeriods = 4.0;
+    }
+    double t = baseTime + nPeriods/qMax(f, 20.0);
+    return 1.0e6 * t * qMax(pInstrument->averages, 1);
+}
+
+
+void
+Hp4284aSimulator::startOperation(Instrument* pInstrument, QVector<double> opFrequencies, int events, bool bCorrection) {
+    double totalTime = 0.0;
+    for(int i=0; i<opFrequencies.count(); i++) {
+        totalTime += measureTime(pInstrument, opFrequencies.at(i));
+        if(!bCorrection)
+            totalTime += 1.0e6 * pInstrument->triggerDelay;
+    }
+    pInstrument->bBusy = true;
+    pInstrument->completionTime = now() + qint64(totalTime * timeScale);
+    pInstrument->pendingEvents = events;
+    pInstrument->pendingFrequencies = bCorrection ? QVector<double>() : opFrequencies;
+}
+
+
+// The admittance of the cell Y = i*w*c0*eps* converted in the pair of
+// values of the selected measurement function.
+void
+Hp4284aSimulator::computeValues(Instrument* pInstrument, double f, double* pA, double* pB) {
+    typedef std::complex<double> Complex;
+    const double e0 = 8.854e-12;
+    const double w = 2.0*M_PI*f;
+    Complex iwt = Complex(0.0, w*model.tau);
+    Complex eps = model.epsInf +
+                  model.deltaEps / pow(1.0 + pow(iwt, model.alpha), model.beta);
+    eps -= Complex(0.0, model.sigma/(w*e0));
+    Complex Y = Complex(0.0, w*model.c0) * eps;
+    Y = Complex(Y.real()*(1.0 + model.noise*gaussian()),
+                Y.imag()*(1.0 + model.noise*gaussian()));
+    Complex Z = 1.0 / Y;
+    double G = Y.real();
+    double B = Y.imag();
+    double R = Z.real();
+    double X = Z.imag();
+    const QString& sFunction = pInstrument->sFunction;
+    double A;
+    // Primary parameter
+    if(sFunction.startsWith("CP"))      A = B/w;
+    else if(sFunction.startsWith("LP")) A = -1.0/(w*B);
+    else if(sFunction.startsWith("CS")) A = -1.0/(w*X);
+    else if(sFunction.startsWith("LS")) A = X/w;
+    else if(sFunction == "RX")          A = R;
+    else if(sFunction.startsWith("ZT")) A = abs(Z);
+    else if(sFunction == "GB")          A = G;
+    else                                A = abs(Y); // YTD, YTR
+    *pA = A;
+    // Secondary parameter
+    bool bParallel = sFunction.startsWith("CP") || sFunction.startsWith("LP");
+    if(sFunction.endsWith("D") && (bParallel || sFunction.startsWith("CS") || sFunction.startsWith("LS")))
+        *pB = bParallel ? G/fabs(B) : R/fabs(X);
+    else if(sFunction.endsWith("Q"))
+        *pB = bParallel ? fabs(B)/G : fabs(X)/R;
+    else if(sFunction.endsWith("RP"))
+        *pB = 1.0/G;
+    else if(sFunction.endsWith("RS"))
+        *pB = R;
+    else if(sFunction.endsWith("G"))
+        *pB = G;
+    else if(sFunction == "RX")
+        *pB = X;
+    else if(sFunction == "GB")
+        *pB = B;
+    else if(sFunction == "ZTD")
+        *pB = arg(Z)*180.0/M_PI;
+    else if(sFunction == "ZTR")
+        *pB = arg(Z);
+    else if(sFunction == "YTD")
+        *pB = arg(Y)*180.0/M_PI;
+    else
+        *pB = arg(Y); // YTR
+}
+
+
+// <DATA A>,<DATA B>,<STATUS> or, for a list sweep,
+// <DATA A>,<DATA B>,<STATUS>,<IN/OUT> for each point.
+QByteArray
+Hp4284aSimulator::fetch(Instrument* pInstrument) {
+    bool bList = pInstrument->resultFrequencies.count() > 1 ||
+                 pInstrument->sDisplayPage == "LIST";
+    QVector<double> resultFrequencies = pInstrument->resultFrequencies;
+    // In continuous mode the last internal measure is returned
+    if(resultFrequencies.isEmpty() || (pInstrument->sTriggerSource == "INT")) {
+        resultFrequencies.clear();
+        resultFrequencies.append(pInstrument->frequency);
+    }
+    QByteArray response;
+    if(pInstrument->bBinary)
+        response = "#0";
+    for(int i=0; i<resultFrequencies.count(); i++) {
+        double values[4];
+        computeValues(pInstrument, resultFrequencies.at(i), &values[0], &values[1]);
+        values[2] = 0.0;
+        values[3] = 0.0;
+        int nValues = bList ? 4 : 3;
+        if(pInstrument->bBinary) {
+            for(int j=0; j<nValues; j++) {
+                quint64 iValue;
+                memcpy(&iValue, &values[j], sizeof(iValue));
+                char bytes[8];
+                qToBigEndian<quint64>(iValue, bytes);
+                response.append(bytes, 8);
+            }
+        }
+        else {
+            if(i > 0)
+                response += ",";
+            response += QString::asprintf("%+.5E,%+.5E,%+d",
+                                          values[0], values[1], 0).toLatin1();
+            if(bList)
+                response += ",+0";
+        }
+    }
+    return response;
+}
+
+
+// Executes a program message: units separated by ';'. A header not
+// starting with ':' is relative to the path of the previous one.
+void
+Hp4284aSimulator::execute(Instrument* pInstrument, QByteArray message) {
+    QString sMessage = QString::fromLatin1(message).trimmed();
+    QStringList sUnits = sMessage.split(';');
+    QString sPath;
+    QList<QByteArray> responses;
+    pInstrument->outputQueue.clear();
+    for(int i=0; i<sUnits.count(); i++) {
+        QString sUnit = sUnits.at(i).trimmed();
+        if(sUnit.isEmpty())
+            continue;
+        int iSpace = sUnit.indexOf(QRegExp("\\s"));
+        QString sHeader = (iSpace < 0) ? sUnit : sUnit.left(iSpace);
+        QString sParameters = (iSpace < 0) ? QString() : sUnit.mid(iSpace+1).trimmed();
+        sHeader = sHeader.toUpper();
+        if(!sHeader.startsWith('*')) {
+            if(sHeader.startsWith(':'))
+                sHeader = sHeader.mid(1);
+            else
+                sHeader = sPath + sHeader;
+            QStringList sNodes = sHeader.split(':');
+            for(int j=0; j<sNodes.count(); j++) {
+                QString sNode = sNodes.at(j);
+                bool bQuery = sNode.endsWith('?');
+                if(bQuery)
+                    sNode.chop(1);
+                sNode = shortForms.value(sNode, sNode);
+                sNodes[j] = bQuery ? sNode + "?" : sNode;
+            }
+            sHeader = sNodes.join(':');
+            sNodes.removeLast();
+            sPath = sNodes.isEmpty() ? QString() : sNodes.join(':') + ":";
+        }
+        QByteArray response = executeUnit(pInstrument, sHeader, sParameters);
+        if(!response.isNull())
+            responses.append(response);
+    }
+    if(!responses.isEmpty()) {
+        for(int i=0; i<responses.count(); i++) {
+            if(i > 0)
+                pInstrument->outputQueue += ";";
+            pInstrument->outputQueue += responses.at(i);
+        }
+        pInstrument->outputQueue += "\n";
+    }
+}
+
+
+// Returns a null QByteArray if the unit is not a query
+QByteArray
+Hp4284aSimulator::executeUnit(Instrument* pInstrument, QString sHeader, QString sParameters) {
+    QString sValue = sParameters.toUpper();
+    double value;
+    // Optional nodes
+    if(sHeader == "FUNC:IMP")         sHeader = "FUNC:IMP:TYPE";
+    if(sHeader == "FUNC:IMP?")        sHeader = "FUNC:IMP:TYPE?";
+    if(sHeader == "FETC:IMP?")        sHeader = "FETC?";
+    if(sHeader == "CORR:OPEN:EXEC")   sHeader = "CORR:OPEN";
+    if(sHeader == "CORR:SHOR:EXEC")   sHeader = "CORR:SHOR";
+    if(sHeader == "CORR:SHORT")       sHeader = "CORR:SHOR";
+    if(sHeader == "CORR:SHORT:STAT")  sHeader = "CORR:SHOR:STAT";
+    if(sHeader == "TRIG:IMM")         sHeader = "TRIG";
+    if(sHeader == "STAT:OPER:EVEN?")  sHeader = "STAT:OPER?";
+
+    if(sHeader == "*IDN?") {
+        return QByteArray("HEWLETT-PACKARD,4284A,0,01.20");
+    }
+    if(sHeader == "*RST") {
+        int timeout = pInstrument->timeout;
+        int sre = pInstrument->sre;
+        QStringList errorQueue = pInstrument->errorQueue;
+        reset(pInstrument);
+        pInstrument->timeout = timeout;
+        pInstrument->sre = sre;
+        pInstrument->errorQueue = errorQueue;
+        return QByteArray();
+    }
+    if(sHeader == "*CLS") {
+        pInstrument->operEvent = 0;
+        pInstrument->bSummary = false;
+        pInstrument->errorQueue.clear();
+        return QByteArray();
+    }
+    if(sHeader == "*SRE") {
+        pInstrument->sre = sValue.toInt() & 0xBF;
+        updateSrq(pInstrument);
+        return QByteArray();
+    }
+    if(sHeader == "*SRE?")
+        return QByteArray::number(pInstrument->sre);
+    if(sHeader == "*OPC?")
+        return QByteArray("1");
+    if(sHeader == "SYST:ERR?") {
+        if(pInstrument->errorQueue.isEmpty())
+            return QByteArray("+0,\"No error\"");
+        return pInstrument->errorQueue.takeFirst().toLatin1();
+    }
+    if(sHeader == "STAT:OPER:ENAB") {
+        pInstrument->operEnable = sValue.toInt();
+        updateSrq(pInstrument);
+        return QByteArray();
+    }
+    if(sHeader == "STAT:OPER:ENAB?")
+        return QByteArray::number(pInstrument->operEnable);
+    if(sHeader == "STAT:OPER?") {
+        int operEvent = pInstrument->operEvent;
+        pInstrument->operEvent = 0;
+        pInstrument->bSummary = false;
+        return QByteArray::number(operEvent);
+    }
+    if(sHeader == "FUNC:IMP:TYPE") {
+        static const QStringList sFunctions = {
+            "CPD", "LPRP", "CPQ", "LSD", "CPG", "LSQ", "CPRP", "LSRS", "CSD", "RX",
+            "CSQ", "ZTD", "CSRS", "ZTR", "LPQ", "GB", "LPD", "YTD", "LPG", "YTR"
+        };
+        if(!sFunctions.contains(sValue)) {
+            addError(pInstrument, "-224,\"Illegal parameter value\"");
+            return QByteArray();
+        }
+        pInstrument->sFunction = sValue;
+        return QByteArray();
+    }
+    if(sHeader == "FUNC:IMP:TYPE?")
+        return pInstrument->sFunction.toLatin1();
+    if(sHeader == "FREQ") {
+        if(!parseNumber(sValue, &value) || (value < 20.0) || (value > 1.0e6)) {
+            addError(pInstrument, "-222,\"Data out of range\"");
+            return QByteArray();
+        }
+        pInstrument->frequency = value;
+        return QByteArray();
+    }
+    if(sHeader == "FREQ?")
+        return QString::asprintf("%+.5E", pInstrument->frequency).toLatin1();
+    if(sHeader == "VOLT") {
+        if(!parseNumber(sValue, &value) || (value < 0.005) || (value > 20.0)) {
+            addError(pInstrument, "-222,\"Data out of range\"");
+            return QByteArray();
+        }
+        pInstrument->voltage = value;
+        return QByteArray();
+    }
+    if(sHeader == "VOLT?")
+        return QString::asprintf("%+.5E", pInstrument->voltage).toLatin1();
+    if(sHeader == "APER") {
+        QStringList sFields = sValue.split(',');
+        QString sAperture = sFields.at(0).trimmed().left(4);
+        if(sAperture == "SHORT") sAperture = "SHOR";
+        if((sAperture != "SHOR") && (sAperture != "MED") && (sAperture != "LONG")) {
+            addError(pInstrument, "-224,\"Illegal parameter value\"");
+            return QByteArray();
+        }
+        pInstrument->sAperture = sAperture;
+        if(sFields.count() > 1)
+            pInstrument->averages = qBound(1, sFields.at(1).trimmed().toInt(), 256);
+        return QByteArray();
+    }
+    if(sHeader == "APER?")
+        return QString("%1,%2").arg(pInstrument->sAperture).arg(pInstrument->averages).toLatin1();
+    if(sHeader == "TRIG:DEL") {
+        if(!parseNumber(sValue, &value) || (value < 0.0) || (value > 60.0)) {
+            addError(pInstrument, "-222,\"Data out of range\"");
+            return QByteArray();
+        }
+        pInstrument->triggerDelay = value;
+        return QByteArray();
+    }
+    if(sHeader == "TRIG:SOUR") {
+        pInstrument->sTriggerSource = sValue.left(3) == "HOL" ? "HOLD" : sValue.left(3);
+        return QByteArray();
+    }
+    if(sHeader == "INIT:CONT") {
+        pInstrument->bContinuous = (sValue == "ON") || (sValue == "1");
+        return QByteArray();
+    }
+    if(sHeader == "DISP:PAGE") {
+        pInstrument->sDisplayPage = sValue.left(4);
+        return QByteArray();
+    }
+    if(sHeader == "LIST:MODE") {
+        pInstrument->sListMode = sValue.left(3);
+        return QByteArray();
+    }
+    if(sHeader == "LIST:FREQ") {
+        QStringList sFrequencies = sValue.split(',');
+        QVector<double> listFrequencies;
+        for(int i=0; i<sFrequencies.count(); i++) {
+            if(!parseNumber(sFrequencies.at(i), &value) || (value < 20.0) || (value > 1.0e6)) {
+                addError(pInstrument, "-222,\"Data out of range\"");
+                return QByteArray();
+            }
+            listFrequencies.append(value);
+        }
+        if(listFrequencies.count() > 10) {
+            addError(pInstrument, "-108,\"Parameter not allowed\"");
+            return QByteArray();
+        }
+        pInstrument->listFrequencies = listFrequencies;
+        return QByteArray();
+    }
+    if(sHeader == "FORM:DATA") {
+        if(sValue.startsWith("REAL")) {
+            pInstrument->bBinary = true;
+        }
+        else if(sValue.startsWith("ASC")) {
+            pInstrument->bBinary = false;
+        }
+        else {
+            addError(pInstrument, "-224,\"Illegal parameter value\"");
+        }
+        return QByteArray();
+    }
+    if(sHeader == "TRIG") {
+        if((pInstrument->sTriggerSource != "BUS") || pInstrument->bBusy) {
+            addError(pInstrument, "-211,\"Trigger ignored\"");
+            return QByteArray();
+        }
+        if((pInstrument->sDisplayPage == "LIST") && !pInstrument->listFrequencies.isEmpty())
+            startOperation(pInstrument, pInstrument->listFrequencies, 8|16, false);
+        else
+            startOperation(pInstrument, QVector<double>() << pInstrument->frequency, 16, false);
+        return QByteArray();
+    }
+    if((sHeader == "CORR:OPEN") || (sHeader == "CORR:SHOR")) {
+        if(pInstrument->bBusy) {
+            addError(pInstrument, "-213,\"Init ignored\"");
+            return QByteArray();
+        }
+        // The correction data are measured at 48 preset frequencies
+        QVector<double> correctionFrequencies;
+        for(int i=0; i<48; i++)
+            correctionFrequencies.append(20.0 * pow(5.0e4, i/47.0));
+        startOperation(pInstrument, correctionFrequencies, 1, true);
+        return QByteArray();
+    }
+    if(sHeader == "FETC?") {
+        if(pInstrument->bBusy) {
+            addError(pInstrument, "-230,\"Data corrupt or stale\"");
+            return QByteArray("");
+        }
+        return fetch(pInstrument);
+    }
+    // All the other settings (i.e. BIAS:STAT, CORR:LENG...) are
+    // accepted and remembered but have no effect on the values.
+    static const QStringList sAccepted = {
+        "FUNC:IMP:RANG:AUTO", "AMPL:ALC", "BIAS:STAT",
+        "CORR:OPEN:STAT", "CORR:SHOR:STAT", "CORR:LOAD:STAT", "CORR:LENG"
+    };
+    if(sAccepted.contains(sHeader)) {
+        pInstrument->otherSettings.insert(sHeader, sValue);
+        return QByteArray();
+    }
+    if(sHeader.endsWith('?')) {
+        QString sSetting = sHeader.left(sHeader.length()-1);
+        if(sAccepted.contains(sSetting))
+            return pInstrument->otherSettings.value(sSetting).toLatin1();
+    }
+    addError(pInstrument, "-113,\"Undefined header\"");
+    return QByteArray();
+}
+
+
+Hp4284aSimulator::Instrument*
+Hp4284aSimulator::instrumentAt(int ud) {
+    Instrument* pInstrument = descriptors.value(ud, nullptr);
+    if(!pInstrument) {
+        simIbsta = ERR;
+        simIberr = EDVR;
+        simIbcnt = 0;
+    }
+    return pInstrument;
+}
+
+
+Hp4284aSimulator::Instrument*
+Hp4284aSimulator::instrumentAtAddress(int board, int address) {
+    if(board != boardNumber) {
+        simIbsta = ERR;
+        simIberr = ENEB;
+        simIbcnt = 0;
+        return nullptr;
+    }
+    Instrument* pInstrument = instruments.value(address, nullptr);
+    if(!pInstrument) {
+        simIbsta = ERR;
+        simIberr = ENOL;
+        simIbcnt = 0;
+    }
+    return pInstrument;
+}
+
+
+// As ibdev() the descriptor is returned even if no device is listening
+int
+Hp4284aSimulator::openDevice(int board, int address, int timeout) {
+    QMutexLocker locker(&mutex);
+    if(board != boardNumber) {
+        simIbsta = ERR;
+        simIberr = ENEB;
+        return -1;
+    }
+    Instrument* pInstrument = instruments.value(address, nullptr);
+    if(!pInstrument) {
+        // A device without instrument: every I/O will fail
+        pInstrument = new Instrument;
+        reset(pInstrument);
+        pInstrument->address = -1;
+        instruments.insert(address, pInstrument);
+    }
+    pInstrument->timeout = timeout;
+    int ud = nextUd++;
+    descriptors.insert(ud, pInstrument);
+    simIbsta = CMPL;
+    simIberr = 0;
+    return ud;
+}
+
+
+int
+Hp4284aSimulator::closeDevice(int ud) {
+    QMutexLocker locker(&mutex);
+    if(!instrumentAt(ud))
+        return simIbsta;
+    descriptors.remove(ud);
+    simIbsta = CMPL;
+    return simIbsta;
+}
+
+
+int
+Hp4284aSimulator::isListener(int board, int address, short* pListen) {
+    QMutexLocker locker(&mutex);
+    if(board != boardNumber) {
+        simIbsta = ERR;
+        simIberr = ENEB;
+        return simIbsta;
+    }
+    Instrument* pInstrument = instruments.value(address, nullptr);
+    *pListen = (pInstrument && (pInstrument->address >= 0)) ? 1 : 0;
+    simIbsta = CMPL;
+    return simIbsta;
+}
+
+
+int
+Hp4284aSimulator::clearDevice(int ud) {
+    QMutexLocker locker(&mutex);
+    Instrument* pInstrument = instrumentAt(ud);
+    if(!pInstrument)
+        return simIbsta;
+    deviceClear(pInstrument);
+    simIbsta = CMPL;
+    return simIbsta;
+}
+
+
+int
+Hp4284aSimulator::write(int ud, const char* pData, long count) {
+    QMutexLocker locker(&mutex);
+    Instrument* pInstrument = instrumentAt(ud);
+    if(!pInstrument)
+        return simIbsta;
+    if(pInstrument->address < 0) {
+        simIbsta = ERR;
+        simIberr = ENOL;
+        simIbcnt = 0;
+        return simIbsta;
+    }
+    update(pInstrument);
+    execute(pInstrument, QByteArray(pData, int(count)));
+    simIbsta = CMPL;
+    simIberr = 0;
+    simIbcnt = count;
+    return simIbsta;
+}
+
+
+// Nothing to read means a timeout: it is reported immediately
+int
+Hp4284aSimulator::read(int ud, char* pBuffer, long count) {
+    QMutexLocker locker(&mutex);
+    Instrument* pInstrument = instrumentAt(ud);
+    if(!pInstrument)
+        return simIbsta;
+    update(pInstrument);
+    if(pInstrument->outputQueue.isEmpty()) {
+        simIbsta = ERR | TIMO;
+        simIberr = EABO;
+        simIbcnt = 0;
+        return simIbsta;
+    }
+    int nBytes = int(qMin(count, long(pInstrument->outputQueue.size())));
+    memcpy(pBuffer, pInstrument->outputQueue.constData(), size_t(nBytes));
+    pInstrument->outputQueue.remove(0, nBytes);
+    simIbsta = CMPL;
+    if(pInstrument->outputQueue.isEmpty())
+        simIbsta |= END;
+    simIberr = 0;
+    simIbcnt = nBytes;
+    return simIbsta;
+}
+
+
+// Only the RQS and TIMO conditions are supported
+int
+Hp4284aSimulator::wait(int ud, int mask) {
+    mutex.lock();
+    Instrument* pInstrument = instrumentAt(ud);
+    if(!pInstrument) {
+        mutex.unlock();
+        return simIbsta;
+    }
+    qint64 timeout = timeoutUs[qBound(0, pInstrument->timeout, 17)];
+    qint64 deadline = (timeout > 0) ? now() + timeout : -1;
+    forever {
+        update(pInstrument);
+        if((mask & RQS) && pInstrument->bSrq) {
+            simIbsta = RQS | CMPL;
+            break;
+        }
+        if(!(mask & (RQS|TIMO))) {
+            simIbsta = CMPL;
+            break;
+        }
+        qint64 wakeTime = deadline;
+        if(pInstrument->bBusy && ((wakeTime < 0) || (pInstrument->completionTime < wakeTime)))
+            wakeTime = pInstrument->completionTime;
+        if((mask & TIMO) && (deadline >= 0) && (now() >= deadline)) {
+            simIbsta = TIMO;
+            break;
+        }
+        qint64 sleepTime = (wakeTime < 0) ? 100000 : qMax(wakeTime-now(), qint64(0));
+        mutex.unlock();
+        QThread::usleep(quint64(qMin(sleepTime, qint64(100000)) + 1));
+        mutex.lock();
+    }
+    simIberr = 0;
+    simIbcnt = 0;
+    mutex.unlock();
+    return simIbsta;
+}
+
+
+// The RQS bit (0x40) is set in the returned Status Byte if the
+// instrument was requesting service. The request is then cleared.
+int
+Hp4284aSimulator::serialPoll(int ud, char* pStatusByte) {
+    QMutexLocker locker(&mutex);
+    Instrument* pInstrument = instrumentAt(ud);
+    if(!pInstrument)
+        return simIbsta;
+    update(pInstrument);
+    int statusByte = 0;
+    if(pInstrument->bSummary)                 statusByte |= 0x80;
+    if(pInstrument->bSrq)                     statusByte |= 0x40;
+    if(!pInstrument->outputQueue.isEmpty())   statusByte |= 0x10;
+    pInstrument->bSrq = false;
+    *pStatusByte = char(statusByte);
+    simIbsta = CMPL;
+    simIberr = 0;
+    simIbcnt = 1;
+    return simIbsta;
+}
+
+
+int
+Hp4284aSimulator::setTimeout(int ud, int timeout) {
+    QMutexLocker locker(&mutex);
+    Instrument* pInstrument = instrumentAt(ud);
+    if(!pInstrument)
+        return simIbsta;
+    pInstrument->timeout = timeout;
+    simIbsta = CMPL;
+    return simIbsta;
+}
+
+
+void
+Hp4284aSimulator::interfaceClear(int board) {
+    QMutexLocker locker(&mutex);
+    simIbsta = (board == boardNumber) ? CMPL : ERR;
+    simIberr = (board == boardNumber) ? 0 : ENEB;
+}
+
+
+void
+Hp4284aSimulator::clearAllDevices(int board) {
+    QMutexLocker locker(&mutex);
+    if(board != boardNumber) {
+        simIbsta = ERR;
+        simIberr = ENEB;
+        return;
+    }
+    for(Instrument* pInstrument : instruments)
+        deviceClear(pInstrument);
+    simIbsta = CMPL;
+    simIberr = 0;
+}
+
+
+void
+Hp4284aSimulator::findListeners(int board, QVector<int>& addresses) {
+    QMutexLocker locker(&mutex);
+    addresses.clear();
+    if(board != boardNumber) {
+        simIbsta = ERR;
+        simIberr = ENEB;
+        return;
+    }
+    for(Instrument* pInstrument : instruments) {
+        if(pInstrument->address >= 0)
+            addresses.append(pInstrument->address);
+    }
+    simIbsta = CMPL;
+    simIberr = 0;
+    simIbcnt = addresses.count();
+}
+
+
+void
+Hp4284aSimulator::send(int board, int address, const char* pData, long count) {
+    QMutexLocker locker(&mutex);
+    Instrument* pInstrument = instrumentAtAddress(board, address);
+    if(!pInstrument || (pInstrument->address < 0))
+        return;
+    update(pInstrument);
+    execute(pInstrument, QByteArray(pData, int(count)));
+    simIbsta = CMPL;
+    simIberr = 0;
+    simIbcnt = count;
+}
+
+
+void
+Hp4284aSimulator::receive(int board, int address, char* pBuffer, long count) {
+    QMutexLocker locker(&mutex);
+    Instrument* pInstrument = instrumentAtAddress(board, address);
+    if(!pInstrument || (pInstrument->address < 0))
+        return;
+    int nBytes = int(qMin(count, long(pInstrument->outputQueue.size())));
+    if(nBytes == 0) {
+        simIbsta = ERR | TIMO;
+        simIberr = EABO;
+        simIbcnt = 0;
+        return;
+    }
+    memcpy(pBuffer, pInstrument->outputQueue.constData(), size_t(nBytes));
+    pInstrument->outputQueue.remove(0, nBytes);
+    simIbsta = CMPL | END;
+    simIberr = 0;
+    simIbcnt = nBytes;
+}
+
+
+int
+Hp4284aSimulator::status() {
+    return simIbsta;
+}
+
+
+int
+Hp4284aSimulator::error() {
+    return simIberr;
+}
+
+
+long
+Hp4284aSimulator::count() {
+    return simIbcnt;
+}
@@ -0,0 +1,144 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QMutex>
+#include <QMap>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include "gpibtransport.h"
+
+
+// The simulated sample: a Havriliak-Negami relaxation
+//   eps*(w) = epsInf + deltaEps / (1 + (i*w*tau)^alpha)^beta
+// plus a d.c. conductivity, filling a cell of empty capacitance c0.
+struct DielectricModel {
+    double epsInf;
+    double deltaEps;
+    double tau;      // Relaxation time (s)
+    double alpha;    // Symmetric broadening (0 < alpha <= 1)
+    double beta;     // Asymmetric broadening (0 < beta <= 1)
+    double sigma;    // d.c. conductivity (S/m)
+    double c0;       // Empty cell capacitance (F)
+    double noise;    // Relative noise of the measured admittance
+};
+
+
+// A GPIB bus with one or more HP 4284A connected. The SCPI subset
+// used by the Hp4284a class is understood, the measurement time is
+// modeled on the aperture, the averages and the test frequency and
+// the completion of the operations is signaled with SRQ.
+// Times are multiplied by timeScale (0 means no wait at all).
+class Hp4284aSimulator : public GpibTransport
+{
+public:
+    Hp4284aSimulator(int board, QVector<int> addresses);
+    ~Hp4284aSimulator() override;
+
+public:
+    void setModel(DielectricModel newModel);
+    void setTimeScale(double newTimeScale);
+
+public:
+    int  openDevice(int board, int address, int timeout) override;
+    int  closeDevice(int ud) override;
+    int  isListener(int board, int address, short* pListen) override;
+    int  clearDevice(int ud) override;
+    int  write(int ud, const char* pData, long count) override;
+    int  read(int ud, char* pBuffer, long count) override;
+    int  wait(int ud, int mask) override;
+    int  serialPoll(int ud, char* pStatusByte) override;
+    int  setTimeout(int ud, int timeout) override;
+    void interfaceClear(int board) override;
+    void clearAllDevices(int board) override;
+    void findListeners(int board, QVector<int>& addresses) override;
+    void send(int board, int address, const char* pData, long count) override;
+    void receive(int board, int address, char* pBuffer, long count) override;
+    int  status() override;
+    int  error() override;
+    long count() override;
+
+protected:
+    struct Instrument {
+        int             address;
+        int             timeout;
+        // Settings
+        QString         sFunction;
+        double          frequency;
+        double          voltage;
+        QString         sAperture;
+        int             averages;
+        double          triggerDelay;
+        QString         sTriggerSource;
+        bool            bContinuous;
+        QString         sDisplayPage;
+        QString         sListMode;
+        QVector<double> listFrequencies;
+        bool            bBinary;
+        QMap<QString, QString> otherSettings;
+        // Status reporting
+        int             sre;
+        int             operEnable;
+        int             operEvent;
+        bool            bSummary;
+        bool            bSrq;
+        QStringList     errorQueue;
+        QByteArray      outputQueue;
+        // The operation in progress
+        bool            bBusy;
+        qint64          completionTime;
+        int             pendingEvents;
+        QVector<double> pendingFrequencies;
+        QVector<double> resultFrequencies;
+    };
+
+    void       getSettings();
+    void       reset(Instrument* pInstrument);
+    void       deviceClear(Instrument* pInstrument);
+    void       update(Instrument* pInstrument);
+    void       updateSrq(Instrument* pInstrument);
+    void       execute(Instrument* pInstrument, QByteArray message);
+    QByteArray executeUnit(Instrument* pInstrument, QString sHeader, QString sParameters);
+    void       addError(Instrument* pInstrument, QString sError);
+    void       startOperation(Instrument* pInstrument, QVector<double> opFrequencies, int events, bool bCorrection);
+    double     measureTime(Instrument* pInstrument, double f);
+    void       computeValues(Instrument* pInstrument, double f, double* pA, double* pB);
+    QByteArray fetch(Instrument* pInstrument);
+    Instrument* instrumentAt(int ud);
+    Instrument* instrumentAtAddress(int board, int address);
+    qint64     now();
+
+private:
+    QMutex                   mutex;
+    QElapsedTimer            clock;
+    int                      boardNumber;
+    QMap<int, Instrument*>   instruments; // by GPIB address
+    QMap<int, Instrument*>   descriptors; // by unit descriptor
+    int                      nextUd;
+    DielectricModel          model;
+    double                   timeScale;
+};
@@ -13,7 +13,7 @@ hp4284Tab::hp4284Tab(QWidget *parent)
 
     initUI();
 
-    sNormalStyle = editPollInterval.styleSheet();
+    sNormalStyle = editVoltage.styleSheet();
 
     sErrorStyle  = "QLineEdit { ";
     sErrorStyle += "color: rgb(255, 255, 255);";
@@ -35,16 +35,18 @@ hp4284Tab::initUI() {
 
     checkOpenCorrection.setText("Open Correction");
     checkShortCorrection.setText("Short Correction");
+    checkBinaryTransfer.setText("Binary Data Transfer");
 
-    pLayout->addWidget(new QLabel("Poll Interval[ms]"), 0, 0, 1, 1);
-    pLayout->addWidget(new QLabel("Test Voltage[V]"),   1, 0, 1, 1);
-    pLayout->addWidget(new QLabel("Averages Number"),   2, 0, 1, 1);
-    pLayout->addWidget(&checkOpenCorrection,            3, 0, 1, 1);
-    pLayout->addWidget(&checkShortCorrection,           4, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Test Voltage[V]"),   0, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Averages Number"),   1, 0, 1, 1);
+    pLayout->addWidget(&checkOpenCorrection,            2, 0, 1, 1);
+    pLayout->addWidget(&checkShortCorrection,           3, 0, 1, 1);
+    pLayout->addWidget(&checkBinaryTransfer,            4, 0, 1, 1);
+    pLayout->addWidget(new QLabel("Settling Periods"),  5, 0, 1, 1);
 
-    pLayout->addWidget(&editPollInterval,     0, 1, 1, 1);
-    pLayout->addWidget(&editVoltage,          1, 1, 1, 1);
-    pLayout->addWidget(&editAverages,         2, 1, 1, 1);
+    pLayout->addWidget(&editVoltage,          0, 1, 1, 1);
+    pLayout->addWidget(&editAverages,         1, 1, 1, 1);
+    pLayout->addWidget(&editSettlingPeriods,  5, 1, 1, 1);
 
     setLayout(pLayout);
 }
@@ -52,57 +54,47 @@ hp4284Tab::initUI() {
 
 void
 hp4284Tab::setToolTips() {
-    editPollInterval.setToolTip(QString("Enter a value [100 - 1000]"));
     editVoltage.setToolTip(QString("Enter a value (0.0 - 2.0]"));
     editAverages.setToolTip(QString("Enter a value [1 - 64]"));
     checkOpenCorrection.setToolTip(QString("Enable/Disable Open Correction"));
     checkShortCorrection.setToolTip(QString("Enable/Disable Short Correction"));
+    checkBinaryTransfer.setToolTip(QString("Transfer the measured values as 64 bits binary data"));
+    editSettlingPeriods.setToolTip(QString("Test signal periods waited before each measure [0 - 1000]"));
 }
 
 
 void
 hp4284Tab::connectSignals() {
-    connect(&editPollInterval, SIGNAL(textChanged(QString)),
-            this, SLOT(onPollIntervalTextChanged(QString)));
     connect(&editVoltage, SIGNAL(textChanged(QString)),
             this, SLOT(onVoltageTextChanged(QString)));
     connect(&editAverages, SIGNAL(textChanged(QString)),
             this, SLOT(onAveragesTextChanged(QString)));
+    connect(&editSettlingPeriods, SIGNAL(textChanged(QString)),
+            this, SLOT(onSettlingPeriodsTextChanged(QString)));
 }
 
 
 void
 hp4284Tab::restoreSettings() {
     QSettings settings;
-    editPollInterval.setText(settings.value("hp4284TabPollInterval", "300").toString());
     editVoltage.setText(settings.value("hp4284TabVoltage", "2.0").toString());
     editAverages.setText(settings.value("hp4284TabAverages", "7").toString());
     checkOpenCorrection.setChecked((settings.value("hp4284OpenCorrection", "1")).toInt()!=0);
     checkShortCorrection.setChecked((settings.value("hp4284ShortCorrection", "1")).toInt()!=0);
+    checkBinaryTransfer.setChecked((settings.value("hp4284BinaryTransfer", "0")).toInt()!=0);
+    editSettlingPeriods.setText(settings.value("hp4284TabSettlingPeriods", "5").toString());
 }
 
 
 void
 hp4284Tab::saveSettings() {
     QSettings settings;
-    settings.setValue("hp4284TabPollInterval", editPollInterval.text());
     settings.setValue("hp4284TabVoltage", editVoltage.text());
     settings.setValue("hp4284TabAverages", editAverages.text());
     settings.setValue("hp4284OpenCorrection", checkOpenCorrection.isChecked());
     settings.setValue("hp4284ShortCorrection", checkShortCorrection.isChecked());
-}
-
-
-void
-hp4284Tab::setPollInterval(int interval) {
-    editPollInterval.setText(QString("%1")
-                             .arg(interval));
-}
-
-
-int
-hp4284Tab::getPollInterval() {
-    return editPollInterval.text().toInt();
+    settings.setValue("hp4284BinaryTransfer", checkBinaryTransfer.isChecked());
+    settings.setValue("hp4284TabSettlingPeriods", editSettlingPeriods.text());
 }
 
 
@@ -144,14 +136,34 @@ hp4284Tab::isShortCorrectionEnabled() {
 
 
 void
-hp4284Tab::onPollIntervalTextChanged(QString sValue) {
-    int iValue = sValue.toInt();
-    if(iValue >= 100 && iValue <= 1000) {
-        editPollInterval.setStyleSheet(sNormalStyle);
-    }
-    else {
-        editPollInterval.setStyleSheet(sErrorStyle);
+hp4284Tab::enableBinaryTransfer(bool bEnable) {
+    checkBinaryTransfer.setChecked(bEnable);
+}
+
+
+bool
+hp4284Tab::isBinaryTransferEnabled() {
+    return checkBinaryTransfer.isChecked();
+}
+
+
+double
+hp4284Tab::getSettlingPeriods() {
+    return editSettlingPeriods.text().toDouble();
+}
+
+
+bool
+hp4284Tab::checkValues() {
+    bool bOk;
+    double dValue = editSettlingPeriods.text().toDouble(&bOk);
+    if(!bOk || (dValue < 0.0) || (dValue > 1000.0)) {
+        QMessageBox::critical(this,
+                              "Error in Settling Periods",
+                              QString("Enter a value between 0 and 1000"));
+        return false;
     }
+    return true;
 }
 
 
@@ -179,4 +191,17 @@ hp4284Tab::onAveragesTextChanged(QString sValue) {
 }
 
 
+void
+hp4284Tab::onSettlingPeriodsTextChanged(QString sValue) {
+    bool bOk;
+    double dValue = sValue.toDouble(&bOk);
+    if(bOk && dValue >= 0.0 && dValue <= 1000.0) {
+        editSettlingPeriods.setStyleSheet(sNormalStyle);
+    }
+    else {
+        editSettlingPeriods.setStyleSheet(sErrorStyle);
+    }
+}
+
+
 
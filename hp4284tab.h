@@ -32,20 +32,22 @@ public:
     explicit hp4284Tab(QWidget *parent = nullptr);
     void     restoreSettings();
     void     saveSettings();
-    void     setPollInterval(int interval);
-    int      getPollInterval();
     void     setTestVoltage(double voltage);
     double   getTestVoltage();
     void     enableOpenCorrection(bool bEnable);
     bool     isOpenCorrectionEnabled();
     void     enableShortCorrection(bool bEnable);
     bool     isShortCorrectionEnabled();
+    void     enableBinaryTransfer(bool bEnable);
+    bool     isBinaryTransferEnabled();
+    double   getSettlingPeriods();
+    bool     checkValues();
 
 
 public slots:
-    void onPollIntervalTextChanged(QString sValue);
     void onVoltageTextChanged(QString sValue);
     void onAveragesTextChanged(QString sValue);
+    void onSettlingPeriodsTextChanged(QString sValue);
 
 
 protected:
@@ -54,11 +56,12 @@ protected:
     void connectSignals();
 
 private:
-    QLineEdit editPollInterval;
     QLineEdit editVoltage;
     QLineEdit editAverages;
+    QLineEdit editSettlingPeriods;
     QCheckBox checkOpenCorrection;
     QCheckBox checkShortCorrection;
+    QCheckBox checkBinaryTransfer;
     // QLineEdit styles
     QString sNormalStyle;
     QString sErrorStyle;
@@ -0,0 +1,140 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "instrumentdiscovery.h"
+#include "gpibtransport.h"
+
+#include <QSettings>
+#include <QStringList>
+
+
+InstrumentDiscovery::InstrumentDiscovery(QObject *parent)
+    : QObject(parent)
+    , pThread(nullptr)
+{
+}
+
+
+InstrumentDiscovery::~InstrumentDiscovery() {
+    if(pThread) {
+        pThread->wait();
+        delete pThread;
+    }
+}
+
+
+// The instruments are notified by instrumentFound() and the end of the
+// search by finished(), both queued to the thread of the receivers.
+void
+InstrumentDiscovery::start(QVector<int> boards, bool bFullScan) {
+    if(isRunning())
+        return;
+    if(pThread) {
+        delete pThread;
+        pThread = nullptr;
+    }
+    pThread = QThread::create([this, boards, bFullScan]() {
+        QString sError;
+        discover(boards, bFullScan, &sError);
+        emit finished(sError);
+    });
+    pThread->setObjectName("GPIB Discovery");
+    pThread->start();
+}
+
+
+bool
+InstrumentDiscovery::isRunning() {
+    return pThread && pThread->isRunning();
+}
+
+
+// Blocks until all the boards have been searched.
+// Returns false if no instrument has been found.
+bool
+InstrumentDiscovery::discover(QVector<int> boards, bool bFullScan, QString* pErrorString) {
+    GpibTransport* pTransport = GpibTransport::instance();
+    bool bFound = false;
+    for(int i=0; i<boards.count(); i++) {
+        int board = boards.at(i);
+        QMap<int, QString> instruments;
+        if(!bFullScan)
+            instruments = verifiedCache(board);
+        if(instruments.isEmpty()) {
+            QString sError;
+            instruments = pTransport->scanBus(board, &sError);
+            if(instruments.isEmpty() && pErrorString)
+                *pErrorString += QString("GPIB%1: %2\n").arg(board).arg(sError);
+            saveCache(board, instruments);
+        }
+        QMap<int, QString>::const_iterator it;
+        for(it=instruments.constBegin(); it!=instruments.constEnd(); ++it) {
+            emit instrumentFound(board, it.key(), it.value());
+            bFound = true;
+        }
+    }
+    return bFound;
+}
+
+
+// The instruments of the previous session if they all answer
+// as before, an empty map otherwise.
+QMap<int, QString>
+InstrumentDiscovery::verifiedCache(int board) {
+    GpibTransport* pTransport = GpibTransport::instance();
+    QMap<int, QString> instruments = loadCache(board);
+    QMap<int, QString>::const_iterator it;
+    for(it=instruments.constBegin(); it!=instruments.constEnd(); ++it) {
+        if(pTransport->queryIdn(board, it.key()) != it.value())
+            return QMap<int, QString>();
+    }
+    return instruments;
+}
+
+
+// Saved as a list of "address=IDN" strings, one list for each board
+QMap<int, QString>
+InstrumentDiscovery::loadCache(int board) {
+    QSettings settings;
+    QStringList entries = settings.value(QString("InstrumentCache/GPIB%1").arg(board), QStringList()).toStringList();
+    QMap<int, QString> instruments;
+    for(int i=0; i<entries.count(); i++) {
+        int iSeparator = entries.at(i).indexOf('=');
+        if(iSeparator < 1)
+            continue;
+        instruments.insert(entries.at(i).left(iSeparator).toInt(),
+                           entries.at(i).mid(iSeparator+1));
+    }
+    return instruments;
+}
+
+
+void
+InstrumentDiscovery::saveCache(int board, const QMap<int, QString>& instruments) {
+    QStringList entries;
+    QMap<int, QString>::const_iterator it;
+    for(it=instruments.constBegin(); it!=instruments.constEnd(); ++it)
+        entries.append(QString("%1=%2").arg(it.key()).arg(it.value()));
+    QSettings settings;
+    settings.setValue(QString("InstrumentCache/GPIB%1").arg(board), entries);
+}
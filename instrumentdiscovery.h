@@ -0,0 +1,62 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QMap>
+#include <QString>
+
+
+// Finds the instruments connected to the GPIB boards. The address->*IDN?
+// map of the previous session is verified first, with a single query to
+// each instrument: the bus is cleared and scanned (that takes a lot
+// longer) only if an instrument does not answer as expected or if
+// there is no map. start() does it with its own thread, so that the
+// user interface is usable in the meantime.
+class InstrumentDiscovery : public QObject
+{
+    Q_OBJECT
+public:
+    explicit InstrumentDiscovery(QObject *parent = nullptr);
+    virtual ~InstrumentDiscovery();
+
+public:
+    void start(QVector<int> boards, bool bFullScan);
+    bool isRunning();
+    bool discover(QVector<int> boards, bool bFullScan, QString* pErrorString);
+
+signals:
+    void instrumentFound(int board, int address, QString sIdn);
+    void finished(QString sError);
+
+protected:
+    QMap<int, QString> verifiedCache(int board);
+    QMap<int, QString> loadCache(int board);
+    void               saveCache(int board, const QMap<int, QString>& instruments);
+
+private:
+    QThread* pThread;
+};
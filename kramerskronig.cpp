@@ -0,0 +1,185 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "kramerskronig.h"
+
+#include <algorithm>
+#include <math.h>
+
+
+static const double E0 = 8.854e-12;
+
+
+KramersKronig::KramersKronig()
+    : threshold(0.05)
+    , edgeDecades(0.5)
+{
+}
+
+
+// Relative to |E*|
+void
+KramersKronig::setThreshold(double newThreshold) {
+    threshold = newThreshold;
+}
+
+
+// The points closer than this to the ends of the band are not checked
+void
+KramersKronig::setEdgeDecades(double decades) {
+    edgeDecades = qMax(decades, 0.0);
+}
+
+
+// Each point stands for the interval of ln(x) halfway to its neighbours,
+// so the band is [a, b] with a and b half a step beyond the first and
+// the last point. With g(x) = x*E"(x) (bRealPart) or E'(x) returns
+//     P int_0^inf g(x)/(x^2-w^2) dx = tails +
+//         int_a^b (g(x)-g(w))/(x^2-w^2) dx + g(w) P int_a^b dx/(x^2-w^2)
+// for each w, times 2/pi (bRealPart) or -2w/pi. The regular integrand
+// at x=w is g'(w)/(2w).
+QVector<double>
+KramersKronig::transform(const QVector<double>& omegas, const QVector<double>& values, bool bRealPart) {
+    int n = omegas.count();
+    QVector<double> g(n), slope(n), cell(n), edges(n+1);
+    // Half a step beyond the band
+    double a = omegas.first()*sqrt(omegas.first()/omegas.at(1));
+    double b = omegas.last()*sqrt(omegas.last()/omegas.at(n-2));
+    edges[0] = a;
+    edges[n] = b;
+    for(int i=1; i<n; i++)
+        edges[i] = sqrt(omegas.at(i-1)*omegas.at(i));
+    for(int i=0; i<n; i++) {
+        g[i] = bRealPart ? omegas.at(i)*values.at(i) : values.at(i);
+        // dx = x*d(ln x) over the interval of the point
+        cell[i] = omegas.at(i) * log(edges.at(i+1)/edges.at(i));
+    }
+    for(int i=0; i<n; i++) {
+        int iLow  = qMax(i-1, 0);
+        int iHigh = qMin(i+1, n-1);
+        slope[i] = (g.at(iHigh)-g.at(iLow)) / (omegas.at(iHigh)-omegas.at(iLow));
+    }
+
+    QVector<double> transformed(n);
+    for(int i=0; i<n; i++) {
+        double w  = omegas.at(i);
+        double w2 = w*w;
+        double sum = 0.0;
+        for(int j=0; j<n; j++) {
+            double x = omegas.at(j);
+            if(j == i)
+                sum += slope.at(i)/(2.0*w) * cell.at(j);
+            else
+                sum += (g.at(j)-g.at(i))/(x*x-w2) * cell.at(j);
+        }
+        sum += g.at(i) * log(((b-w)*(a+w))/((b+w)*(w-a))) / (2.0*w);
+        // Outside the band g is taken as constant
+        sum += g.first() * log((w-a)/(w+a)) / (2.0*w);
+        sum += g.last()  * log((b+w)/(b-w)) / (2.0*w);
+        transformed[i] = bRealPart ? (2.0/M_PI)*sum : -(2.0*w/M_PI)*sum;
+    }
+    return transformed;
+}
+
+
+// The points with a non positive frequency are ignored. A DC conductivity
+// adds sigma/(e0*w) to E" without any counterpart in E': it does not
+// change E' from E" but E" from E' misses it. Its amount is estimated
+// from the difference between E" and E" from E' (that would otherwise
+// be due only to noise) and added to the latter before the comparison.
+KramersKronigResult
+KramersKronig::check(const QVector<double>& frequencies,
+                     const QVector<double>& e1,
+                     const QVector<double>& e2)
+{
+    KramersKronigResult result;
+    result.offset      = 0.0;
+    result.sigma       = 0.0;
+    result.maxResidual = 0.0;
+    QVector<int> order;
+    for(int i=0; i<frequencies.count() && i<e1.count() && i<e2.count(); i++) {
+        if(frequencies.at(i) > 0.0)
+            order.append(i);
+    }
+    std::sort(order.begin(), order.end(), [&frequencies](int a, int b) {
+        return frequencies.at(a) < frequencies.at(b);
+    });
+    QVector<double> omegas;
+    for(int i=0; i<order.count(); i++) {
+        int j = order.at(i);
+        // Repeated frequencies would make a null interval
+        if(!result.frequencies.isEmpty() && frequencies.at(j) <= result.frequencies.last())
+            continue;
+        result.frequencies.append(frequencies.at(j));
+        result.e1.append(e1.at(j));
+        result.e2.append(e2.at(j));
+        omegas.append(2.0*M_PI*frequencies.at(j));
+    }
+    int n = omegas.count();
+    if(n < 3)
+        return result;
+    result.e1Kk = transform(omegas, result.e2, true);
+    result.e2Kk = transform(omegas, result.e1, false);
+
+    // The unknown offset of E' is the mean difference over the checked band
+    double fMin = result.frequencies.first()*pow(10.0, edgeDecades);
+    double fMax = result.frequencies.last()/pow(10.0, edgeDecades);
+    QVector<int> checked;
+    for(int i=0; i<n; i++) {
+        if(result.frequencies.at(i) >= fMin && result.frequencies.at(i) <= fMax)
+            checked.append(i);
+    }
+    if(checked.isEmpty())
+        return result;
+    for(int i=0; i<checked.count(); i++)
+        result.offset += result.e1.at(checked.at(i)) - result.e1Kk.at(checked.at(i));
+    result.offset /= checked.count();
+    // Least squares of (E" - E"kk - s/w)/|E*| over the checked band
+    double sumDw = 0.0;
+    double sumWw = 0.0;
+    for(int i=0; i<checked.count(); i++) {
+        int j = checked.at(i);
+        double modulus2 = result.e1.at(j)*result.e1.at(j) + result.e2.at(j)*result.e2.at(j);
+        if(modulus2 <= 0.0)
+            continue;
+        sumDw += (result.e2.at(j)-result.e2Kk.at(j))/(omegas.at(j)*modulus2);
+        sumWw += 1.0/(omegas.at(j)*omegas.at(j)*modulus2);
+    }
+    double s = (sumWw > 0.0) ? qMax(sumDw/sumWw, 0.0) : 0.0;
+    result.sigma = s*E0;
+    result.residuals.resize(n);
+    for(int i=0; i<n; i++) {
+        result.e1Kk[i] += result.offset;
+        result.e2Kk[i] += s/omegas.at(i);
+        double modulus = sqrt(result.e1.at(i)*result.e1.at(i) + result.e2.at(i)*result.e2.at(i));
+        double residual = qMax(qAbs(result.e1.at(i)-result.e1Kk.at(i)),
+                               qAbs(result.e2.at(i)-result.e2Kk.at(i)));
+        result.residuals[i] = (modulus > 0.0) ? residual/modulus : 0.0;
+    }
+    for(int i=0; i<checked.count(); i++) {
+        int j = checked.at(i);
+        result.maxResidual = qMax(result.maxResidual, result.residuals.at(j));
+        if(result.residuals.at(j) > threshold)
+            result.flagged.append(j);
+    }
+    return result;
+}
@@ -0,0 +1,71 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QVector>
+#include <QString>
+
+
+struct KramersKronigResult {
+    QVector<double> frequencies;  // Hz, ascending
+    QVector<double> e1;           // Measured
+    QVector<double> e2;
+    QVector<double> e1Kk;         // E' from E" (plus the fitted offset)
+    QVector<double> e2Kk;         // E" from E' (plus the conductivity)
+    QVector<double> residuals;    // max(|E'-E'kk|, |E"-E"kk|)/|E*|
+    QVector<int>    flagged;      // Indexes of the inconsistent points
+    double          offset;       // eInf plus the contribution of the missing band
+    double          sigma;        // Estimated DC conductivity (S/m)
+    double          maxResidual;  // Over the checked (not edge) points
+};
+
+
+// Kramers-Kronig consistency of a measured spectrum:
+//     E'(w)  = eInf + (2/pi) P int_0^inf x*E"(x)/(x^2-w^2) dx
+//     E"(w)  =       -(2w/pi) P int_0^inf E'(x)/(x^2-w^2) dx
+// The integrals are restricted to the measured band and computed in
+// ln(x) with the trapezoidal rule, after subtracting the value at the
+// pole (whose principal value integral is analytic). Outside the band
+// the integrands are extrapolated as constants; that is still rough near
+// the ends of the band, whose points are not checked.
+class KramersKronig
+{
+public:
+    KramersKronig();
+
+public:
+    void                setThreshold(double newThreshold);
+    void                setEdgeDecades(double decades);
+    KramersKronigResult check(const QVector<double>& frequencies,
+                              const QVector<double>& e1,
+                              const QVector<double>& e2);
+
+protected:
+    static QVector<double> transform(const QVector<double>& omegas,
+                                     const QVector<double>& values,
+                                     bool bRealPart);
+
+private:
+    double threshold;
+    double edgeDecades;
+};
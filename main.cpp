@@ -1,7 +1,14 @@
 #include "mainwindow.h"
+#include "hp4284asimulator.h"
+#include "sweep.h"
+#include "controlserver.h"
+#include "sessionmanager.h"
+#include "spectrumanalyzer.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QFileInfo>
+#include <QCommandLineParser>
+#include <QScopedPointer>
 
 
 //#define TEST_NO_INTERFACE
@@ -31,53 +38,267 @@ myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QString
 }
 
 
+// Exit status of the headless mode
+static const int HEADLESS_COMPLETED        = 0;
+static const int HEADLESS_BAD_ARGUMENTS    = 1;
+static const int HEADLESS_NO_INSTRUMENT    = 2;
+static const int HEADLESS_FILE_ERROR       = 3;
+static const int HEADLESS_INSTRUMENT_ERROR = 4;
+static const int HEADLESS_INCONSISTENT     = 5;
+
+
+// Reads a numeric option checking its range
+bool
+toNumber(QCommandLineParser& parser, QString sOption, double min, double max, double* pValue) {
+    if(parser.value(sOption).isEmpty())
+        return true;
+    bool bOk;
+    double value = parser.value(sOption).toDouble(&bOk);
+    if(!bOk || (value < min) || (value > max)) {
+        fprintf(stderr, "Invalid --%s value: %s [%g - %g]\n",
+                sOption.toLocal8Bit().constData(),
+                parser.value(sOption).toLocal8Bit().constData(),
+                min, max);
+        return false;
+    }
+    *pValue = value;
+    return true;
+}
+
+
+// Runs a sweep (or resumes the interrupted one) without any user
+// interface, i.e. from a script. Returns the process exit status.
+int
+runHeadless(QCommandLineParser& parser, QVector<int> gpibBoards) {
+    // The defaults are the ones of the options
+    SweepConfig config;
+    config.sSampleInfo      = parser.value("info");
+    config.sFrequencyFile   = parser.value("frequency-file");
+    config.sOutputFile      = parser.value("output");
+    config.derivedQuantities = parser.value("derived").split(',', QString::SkipEmptyParts);
+    config.bOpenCorrection  = parser.isSet("open-correction");
+    config.bShortCorrection = parser.isSet("short-correction");
+    config.bBinaryTransfer  = parser.isSet("binary");
+    double averages         = 0.0; // The instrument setting
+    double pointsPerDecade  = 0.0;
+    double extraPoints      = 0.0;
+    bool bResume            = parser.isSet("resume");
+    if(!toNumber(parser, "area",              1.0e-3, 1.0e6,  &config.area)            ||
+       !toNumber(parser, "thickness",         1.0e-6, 1.0e3,  &config.thickness)       ||
+       !toNumber(parser, "voltage",           0.1,    2.0,    &config.testVoltage)     ||
+       !toNumber(parser, "averages",          1.0,    64.0,   &averages)               ||
+       !toNumber(parser, "settling",          0.0,    1000.0, &config.settlingPeriods) ||
+       !toNumber(parser, "fmin",              20.0,   1.0e6,  &config.fMin)            ||
+       !toNumber(parser, "fmax",              20.0,   1.0e6,  &config.fMax)            ||
+       !toNumber(parser, "points-per-decade", 1.0,    100.0,  &pointsPerDecade)        ||
+       !toNumber(parser, "extra-points",      0.0,    500.0,  &extraPoints)            ||
+       !toNumber(parser, "threshold",         0.0,    10.0,   &config.threshold))
+        return HEADLESS_BAD_ARGUMENTS;
+    config.averages        = int(averages);
+    config.pointsPerDecade = int(pointsPerDecade);
+    config.extraPoints     = int(extraPoints);
+    config.planMode = FrequencyPlan::modeFromName(parser.value("plan"));
+    if(config.planMode < 0) {
+        fprintf(stderr, "Invalid --plan value: %s [log, file, adaptive]\n",
+                parser.value("plan").toLocal8Bit().constData());
+        return HEADLESS_BAD_ARGUMENTS;
+    }
+    bool bControl = parser.isSet("control");
+    if(!bResume && !bControl && config.sOutputFile.isEmpty()) {
+        fprintf(stderr, "The --output file is required\n");
+        return HEADLESS_BAD_ARGUMENTS;
+    }
+
+    // Kept apart from the journals of the interactive sessions
+    SessionManager sessions("HeadlessRunJournal");
+    QString sError;
+    if(parser.isSet("address"))
+        sessions.addMeter(gpibBoards.first(), parser.value("address").toInt());
+    else
+        sessions.discover(gpibBoards, parser.isSet("rescan"), &sError);
+    if(sessions.count() == 0) {
+        fprintf(stderr, "%s\n", sError.toLocal8Bit().constData());
+        return HEADLESS_NO_INSTRUMENT;
+    }
+    for(int i=0; i<sessions.count(); i++) {
+        QString sName = sessions.name(i);
+        auto printMessage = [sName](QString sMessage) {
+            fprintf(stderr, "%s: %s\n", sName.toLocal8Bit().constData(), sMessage.toLocal8Bit().constData());
+        };
+        QObject::connect(sessions.meter(i), &Hp4284a::aMessage, printMessage);
+        QObject::connect(sessions.sweep(i), &Sweep::message, printMessage);
+        QObject::connect(sessions.sweep(i), &Sweep::writeError, printMessage);
+    }
+    // Without the control socket the single measure is made by the first meter
+    Sweep& sweep = *sessions.sweep(0);
+    // When controlled through the local socket the
+    // application exits only on the "quit" command
+    ControlServer controlServer(&sessions);
+    for(int i=0; i<sessions.count(); i++)
+        controlServer.setConfig(i, config);
+    if(bControl) {
+        if(!controlServer.listen(parser.value("control"), &sError)) {
+            fprintf(stderr, "Unable to open the control socket: %s\n", sError.toLocal8Bit().constData());
+            return HEADLESS_FILE_ERROR;
+        }
+        QObject::connect(&controlServer, &ControlServer::quitRequested, []() {
+            QCoreApplication::exit(HEADLESS_COMPLETED);
+        });
+    }
+    else {
+        QObject::connect(&sweep, &Sweep::finished, [&parser, &sweep](bool bCompleted) {
+            int exitCode = bCompleted ? HEADLESS_COMPLETED : HEADLESS_INSTRUMENT_ERROR;
+            if(bCompleted && parser.isSet("kk")) {
+                SpectrumAnalyzer analyzer;
+                QString sResult;
+                int nFlagged = 0;
+                analyzer.setKkThreshold(parser.value("kk-threshold").toDouble());
+                if(!analyzer.checkConsistency(sweep.points(), sweep.currentConfig().sOutputFile, &sResult, &nFlagged))
+                    fprintf(stderr, "Kramers-Kronig check failed: %s\n", sResult.toLocal8Bit().constData());
+                else
+                    printf("%s\n", sResult.toLocal8Bit().constData());
+                if(nFlagged > 0)
+                    exitCode = HEADLESS_INCONSISTENT;
+            }
+            // The fit is made here: the process is ending anyway
+            if(bCompleted && parser.isSet("fit")) {
+                SpectrumAnalyzer analyzer;
+                QString sResult;
+                analyzer.setStarts(parser.value("fit-starts").toInt());
+                if(!analyzer.setModel(parser.value("fit"), &sResult) ||
+                   !analyzer.analyze(sweep.points(), sweep.currentConfig().sOutputFile, &sResult))
+                    fprintf(stderr, "Fit failed: %s\n", sResult.toLocal8Bit().constData());
+                else
+                    printf("%s\n", sResult.toLocal8Bit().constData());
+            }
+            QCoreApplication::exit(exitCode);
+        });
+    }
+    if(bResume) {
+        if(sweep.interruptedRun().isEmpty()) {
+            fprintf(stderr, "No interrupted measure to resume\n");
+            return HEADLESS_BAD_ARGUMENTS;
+        }
+        if(!sweep.resume(&sError)) {
+            fprintf(stderr, "Unable to resume the measure: %s\n", sError.toLocal8Bit().constData());
+            return HEADLESS_FILE_ERROR;
+        }
+        // It could be already completed
+        if(!sweep.isRunning() && !bControl)
+            return HEADLESS_COMPLETED;
+    }
+    else if(!config.sOutputFile.isEmpty() && !sweep.start(config, &sError)) {
+        fprintf(stderr, "Unable to start the measure: %s\n", sError.toLocal8Bit().constData());
+        return HEADLESS_FILE_ERROR;
+    }
+    return QCoreApplication::exec();
+}
+
+
 int
 main(int argc, char *argv[]) {
-    QApplication a(argc, argv);
-    QMessageBox msgBox;
+    // The headless mode must not need any display
+    bool bHeadless = false;
+    for(int i=1; i<argc; i++) {
+        if(QByteArray(argv[i]) == "--headless")
+            bHeadless = true;
+    }
+    QScopedPointer<QCoreApplication> pApplication(bHeadless ? new QCoreApplication(argc, argv)
+                                                            : new QApplication(argc, argv));
 
-    int gpibBoardID = 0;
+    QVector<int> gpibBoards;
 
     QCoreApplication::setOrganizationDomain("Gabriele.Salvato");
     QCoreApplication::setOrganizationName("Gabriele.Salvato");
     QCoreApplication::setApplicationName("Dielectric");
     QCoreApplication::setApplicationVersion("1.0.0");
 
-#ifndef TEST_NO_INTERFACE
-    QString sGpibInterface = QString("/dev/gpib%1").arg(gpibBoardID);
-    QFileInfo checkFile(sGpibInterface);
-    while(!checkFile.exists()) {
-        msgBox.setWindowTitle(QCoreApplication::applicationName());
-        msgBox.setIcon(QMessageBox::Critical);
-        msgBox.setText(QString("No %1 device file").arg(sGpibInterface));
-        msgBox.setInformativeText(QString("Is the GPIB Interface connected ? "));
-        msgBox.setStandardButtons(QMessageBox::Abort|QMessageBox::Retry);
-        msgBox.setDefaultButton(QMessageBox::Retry);
-        if(msgBox.exec() == QMessageBox::Abort)
-            return 0;
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Dielectric spectroscopy with the HP 4284A");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption simulateOption("simulate",
+                                      "Use simulated HP 4284A at GPIB0 <addresses> (i.e. 17,18) instead of the real bus.",
+                                      "addresses");
+    parser.addOption(simulateOption);
+    QCommandLineOption boardsOption("boards",
+                                    "The GPIB <boards> to use (i.e. 0,1). All the available ones if not given.",
+                                    "boards");
+    parser.addOption(boardsOption);
+    // Headless mode
+    parser.addOption(QCommandLineOption("headless", "Run a single measure without the user interface."));
+    parser.addOption(QCommandLineOption("resume", "Resume the interrupted headless measure."));
+    parser.addOption(QCommandLineOption("address", "GPIB <address> of the HP 4284A (the bus is scanned if not given).", "address"));
+    parser.addOption(QCommandLineOption("area", "Sample <area> in mm^2.", "area", "1.0"));
+    parser.addOption(QCommandLineOption("thickness", "Sample <thickness> in mm.", "thickness", "1.0"));
+    parser.addOption(QCommandLineOption("info", "Sample <information> for the file header.", "information"));
+    parser.addOption(QCommandLineOption("voltage", "Test signal <voltage> [0.1 - 2.0] V.", "voltage", "2.0"));
+    parser.addOption(QCommandLineOption("averages", "Number of <averages> [1 - 64] (the instrument setting if not given).", "averages"));
+    parser.addOption(QCommandLineOption("settling", "Test signal <periods> waited before each measure [0 - 1000].", "periods", "5"));
+    parser.addOption(QCommandLineOption("open-correction", "Enable the OPEN correction."));
+    parser.addOption(QCommandLineOption("short-correction", "Enable the SHORT correction."));
+    parser.addOption(QCommandLineOption("binary", "Use the binary data transfer."));
+    parser.addOption(QCommandLineOption("plan", "Frequency <plan>: log, file or adaptive.", "plan", "log"));
+    parser.addOption(QCommandLineOption("fmin", "Minimum <frequency> in Hz.", "frequency", "20"));
+    parser.addOption(QCommandLineOption("fmax", "Maximum <frequency> in Hz.", "frequency", "1000000"));
+    parser.addOption(QCommandLineOption("points-per-decade", "<points> per decade of the logarithmic grid.", "points", "10"));
+    parser.addOption(QCommandLineOption("frequency-file", "<file> with the frequencies of the file plan.", "file"));
+    parser.addOption(QCommandLineOption("extra-points", "Max <points> added by the adaptive plan [0 - 500].", "points", "30"));
+    parser.addOption(QCommandLineOption("threshold", "Relative change that adds a <frequency> in the adaptive plan.", "threshold", "0.15"));
+    parser.addOption(QCommandLineOption("output", "Output <file> (the .run file is written alongside).", "file"));
+    parser.addOption(QCommandLineOption("derived", "Derived <quantities> to output (i.e. M1,M2,Sigma,Z1,Z2,E2der).", "quantities"));
+    parser.addOption(QCommandLineOption("control", "Wait for commands on the local socket <name>.", "name"));
+    parser.addOption(QCommandLineOption("fit", "Fit the <model> (i.e. HN+CC+DC) to the measured spectrum.", "model"));
+    parser.addOption(QCommandLineOption("fit-starts", "Initial <guesses> of the fit.", "guesses", "16"));
+    parser.addOption(QCommandLineOption("kk", "Check the Kramers-Kronig consistency of the measured spectrum."));
+    parser.addOption(QCommandLineOption("kk-threshold", "Maximum relative <residual> of a consistent point.", "residual", "0.05"));
+    parser.addOption(QCommandLineOption("rescan", "Scan the GPIB bus instead of checking the instruments of the previous session."));
+    parser.process(*pApplication);
+
+    bool bSimulate = parser.isSet(simulateOption);
+    if(bSimulate) {
+        QVector<int> addresses;
+        QStringList sAddresses = parser.value(simulateOption).split(',');
+        for(int i=0; i<sAddresses.count(); i++)
+            addresses.append(sAddresses.at(i).toInt());
+        GpibTransport::setInstance(new Hp4284aSimulator(0, addresses));
+        gpibBoards.append(0);
+    }
+    else if(parser.isSet(boardsOption)) {
+        QStringList sBoards = parser.value(boardsOption).split(',');
+        for(int i=0; i<sBoards.count(); i++)
+            gpibBoards.append(sBoards.at(i).toInt());
+    }
+    else {
+        gpibBoards = SessionManager::availableBoards();
+    }
+    if(bHeadless) {
+        if(gpibBoards.isEmpty()) {
+            fprintf(stderr, "No GPIB board available\n");
+            return HEADLESS_NO_INSTRUMENT;
+        }
+        return runHeadless(parser, gpibBoards);
     }
-#endif
 
-    MainWindow w(gpibBoardID);
-    w.show();
-    QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+    QMessageBox msgBox;
 
 #ifndef TEST_NO_INTERFACE
-    while(!w.checkInstruments()) {
-        QMessageBox msgBox;
+    while(gpibBoards.isEmpty()) {
         msgBox.setWindowTitle(QCoreApplication::applicationName());
         msgBox.setIcon(QMessageBox::Critical);
-        msgBox.setText(QString("GPIB Instruments Not Found"));
-        msgBox.setInformativeText(QString("Switch on and retry"));
+        msgBox.setText(QString("No /dev/gpib device file"));
+        msgBox.setInformativeText(QString("Is the GPIB Interface connected ? "));
         msgBox.setStandardButtons(QMessageBox::Abort|QMessageBox::Retry);
         msgBox.setDefaultButton(QMessageBox::Retry);
-        if(msgBox.exec()==QMessageBox::Abort)
+        if(msgBox.exec() == QMessageBox::Abort)
             return 0;
+        gpibBoards = SessionManager::availableBoards();
     }
 #endif
 
+    MainWindow w(gpibBoards);
+    w.show();
     w.updateUserInterface();
-
-    QApplication::restoreOverrideCursor();
-    return a.exec();
+    w.startDiscovery(parser.isSet("rescan"));
+    return pApplication->exec();
 }
@@ -41,47 +41,43 @@
 #include <QFileInfo>
 #include <QThread>
 #include <QApplication>
+#include <algorithm>
 
-MainWindow::MainWindow(int iBoard, QWidget *parent)
+MainWindow::MainWindow(QVector<int> boards, QWidget *parent)
     : QMainWindow(parent)
-    , pOutputFile(nullptr)
-    , pLogFile(nullptr)
+    , pLogWriter(nullptr)
     , pHp4284a(nullptr)
+    , pSweep(nullptr)
+    , pSessions(nullptr)
+    , pControlServer(nullptr)
+    , pDiscovery(nullptr)
+    , pAnalyzer(nullptr)
     , pPlotE1_Om(nullptr)
     , pPlotE2_Om(nullptr)
     , pPlotTD_Om(nullptr)
+    , pPlotDerived(nullptr)
     , pConfigureDlg(nullptr)
     , pShowE1_F(nullptr)
     , pShowE2_F(nullptr)
     , pShowTD_F(nullptr)
+    , pShowDerived(nullptr)
+    , pDerivedCombo(nullptr)
     , pStatusBar(nullptr)
-    , gpibBoardID(iBoard)
-    , e0(8.854e-12)
+    , gpibBoards(boards)
 {
     // Init internal variables
-    frequencies =
-    {
-               20,        25,        30,        40,        50,
-               60,        80,       100,       120,       150,
-              200,       250,       300,       400,       500,
-              600,       800,   1*1.0e3, 1.2*1.0e3, 1.5*1.0e3,
-          2*1.0e3, 2.5*1.0e3,   3*1.0e3,   4*1.0e3,   5*1.0e3,
-          6*1.0e3,   8*1.0e3,  10*1.0e3,  12*1.0e3,  15*1.0e3,
-         20*1.0e3,  25*1.0e3,  30*1.0e3,  40*1.0e3,  50*1.0e3,
-         60*1.0e3,  80*1.0e3, 100*1.0e3, 120*1.0e3, 150*1.0e3,
-        200*1.0e3, 250*1.0e3, 300*1.0e3, 400*1.0e3, 500*1.0e3,
-        600*1.0e3, 800*1.0e3,   1*1.0e6
-    };
-    nFrequencies = frequencies.count();
-
     bPlotE1_Om = true;
     bPlotE2_Om = true;
     bPlotTD_Om = true;
-    stabilizeTime = 1000; // ms
 
     //setSizeGripEnabled(false);// To remove the resize-handle in the lower right corner
     setFixedSize(size());// To make the size of the window fixed
 
+    // The log file is written by its own thread
+    pLogWriter = new DataWriter(this);
+    pLogWriter->setFlushPolicy(settings.value("logWriterFlushBytes", 4*1024).toInt(),
+                               settings.value("logWriterFlushMs", 200).toInt());
+
     // Prepare message logging
     sLogFileName = QString("dieletricLog.txt");
     sLogDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
@@ -89,6 +85,40 @@ MainWindow::MainWindow(int iBoard, QWidget *parent)
     sLogFileName = sLogDir+sLogFileName;
     prepareLogFile();
 
+    // One Sweep for each meter, driven by the user interface (the first
+    // one) and by the lab automation, through the control socket
+    pSessions = new SessionManager("RunJournal", this);
+    connect(pSessions, SIGNAL(meterAdded(int)),
+            this, SLOT(onMeterAdded(int)));
+    pDiscovery = new InstrumentDiscovery(this);
+    connect(pDiscovery, SIGNAL(instrumentFound(int,int,QString)),
+            pSessions, SLOT(onInstrumentFound(int,int,QString)));
+    connect(pDiscovery, SIGNAL(instrumentFound(int,int,QString)),
+            this, SLOT(onInstrumentFound(int,int,QString)));
+    connect(pDiscovery, SIGNAL(finished(QString)),
+            this, SLOT(onDiscoveryFinished(QString)));
+    // Every completed spectrum is fitted to the relaxation model
+    QString sError;
+    pAnalyzer = new SpectrumAnalyzer(this);
+    pAnalyzer->setStarts(settings.value("fitStarts", 16).toInt());
+    pAnalyzer->setKkThreshold(settings.value("kkThreshold", 0.05).toDouble());
+    QString sFitModel = settings.value("fitModel", "HN+DC").toString();
+    if(!pAnalyzer->setModel(sFitModel, &sError))
+        logMessage(sError);
+    connect(pAnalyzer, SIGNAL(fitDone(QString)),
+            this, SLOT(onFitDone(QString)));
+    connect(pAnalyzer, SIGNAL(kkChecked(QString,int)),
+            this, SLOT(onKkChecked(QString,int)));
+    connect(pAnalyzer, SIGNAL(message(QString)),
+            this, SLOT(onSweepMessage(QString)));
+    QString sSocketName = settings.value("controlSocketName", "dielectric").toString();
+    pControlServer = new ControlServer(pSessions, this);
+    connect(pControlServer, SIGNAL(quitRequested()),
+            this, SLOT(close()), Qt::QueuedConnection);
+    if(!pControlServer->listen(sSocketName, &sError))
+        logMessage(QString("Unable to open the control socket %1: %2")
+                   .arg(sSocketName, sError));
+
     getSettings();
     initLayout();
     setToolTips();
@@ -112,18 +142,33 @@ MainWindow::closeEvent(QCloseEvent *event) {
     if(pPlotE1_Om)    delete pPlotE1_Om;
     if(pPlotE2_Om)    delete pPlotE2_Om;
     if(pPlotTD_Om)    delete pPlotTD_Om;
+    if(pPlotDerived)  delete pPlotDerived;
     if(pConfigureDlg) delete pConfigureDlg;
-    if(pOutputFile)   delete pOutputFile;
+    if(pAnalyzer)      delete pAnalyzer;
+    pAnalyzer = nullptr;
+    if(pDiscovery)     delete pDiscovery;
+    pDiscovery = nullptr;
+    // It could be executing one of its slots
+    if(pControlServer) {
+        pControlServer->close();
+        pControlServer->deleteLater();
+    }
+    pControlServer = nullptr;
+    // Waits for the pending data to be written
+    if(pSessions)     delete pSessions;
+    pSessions = nullptr;
+    pHp4284a = nullptr;
+    pSweep = nullptr;
     if(pShowE1_F)      delete pShowE1_F;
     if(pShowE2_F)      delete pShowE2_F;
     if(pShowTD_F)      delete pShowTD_F;
+    if(pShowDerived)   delete pShowDerived;
+    if(pDerivedCombo)  delete pDerivedCombo;
 
-    if(pLogFile) {
-        if(pLogFile->isOpen()) {
-            pLogFile->flush();
-        }
-        pLogFile->deleteLater();
-        pLogFile = nullptr;
+    // Waits for the pending messages to be written
+    if(pLogWriter) {
+        delete pLogWriter;
+        pLogWriter = nullptr;
     }
 }
 
@@ -143,13 +188,11 @@ MainWindow::prepareLogFile() {
                        sLogFileName+QString("_0.txt"));
     }
     // Open the new log file
-    pLogFile = new QFile(sLogFileName);
-    if (!pLogFile->open(QIODevice::WriteOnly)) {
+    QString sError;
+    if (!pLogWriter->open(sLogFileName, QIODevice::WriteOnly, &sError)) {
         QMessageBox::information(Q_NULLPTR, "Conductivity",
                                  QString("Unable to open file %1: %2.")
-                                 .arg(sLogFileName, pLogFile->errorString()));
-        delete pLogFile;
-        pLogFile = Q_NULLPTR;
+                                 .arg(sLogFileName, sError));
     }
     return true;
 }
@@ -161,15 +204,8 @@ MainWindow::logMessage(QString sMessage) {
     QString sDebugMessage = dateTime.currentDateTime().toString() +
             QString(" - ") +
             sMessage;
-    if(pLogFile) {
-        if(pLogFile->isOpen()) {
-            pLogFile->write(sDebugMessage.toUtf8().data());
-            pLogFile->write("\n");
-            pLogFile->flush();
-        }
-        else
-            qDebug() << sDebugMessage;
-    }
+    if(pLogWriter && pLogWriter->isOpen())
+        pLogWriter->writeData(sDebugMessage.toUtf8() + "\n");
     else
         qDebug() << sDebugMessage;
 }
@@ -204,10 +240,18 @@ MainWindow::initLayout() {
     pShowE1_F->setChecked(true);
     pShowE2_F->setChecked(true);
     pShowTD_F->setChecked(true);
+    pShowDerived = new QCheckBox(tr("Show Derived(F)"));
+    pShowDerived->setChecked(false);
+    pDerivedCombo = new QComboBox();
+    for(int i=0; i<DerivedQuantities::N_QUANTITIES; i++)
+        pDerivedCombo->addItem(DerivedQuantities::label(i));
+    pDerivedCombo->setCurrentIndex(settings.value("derivedPlot", DerivedQuantities::M2).toInt());
     QVBoxLayout *vbox = new QVBoxLayout;
     vbox->addWidget(pShowE1_F);
     vbox->addWidget(pShowE2_F);
     vbox->addWidget(pShowTD_F);
+    vbox->addWidget(pShowDerived);
+    vbox->addWidget(pDerivedCombo);
     pPlotBox->setLayout(vbox);
     // Status Bar
     pStatusBar = QMainWindow::statusBar();
@@ -254,121 +298,87 @@ MainWindow::connectSignals() {
             this, SLOT(onShowE2()));
     connect(pShowTD_F, SIGNAL(clicked()),
             this, SLOT(onShowTD()));
+    connect(pShowDerived, SIGNAL(clicked()),
+            this, SLOT(onShowDerived()));
+    connect(pDerivedCombo, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(onDerivedPlotChanged(int)));
 }
 
 
-bool
-MainWindow::checkInstruments() {
-    SendIFC(gpibBoardID);
-    if(ThreadIbsta() & ERR) {
-        QMessageBox msgBox;
-        msgBox.setWindowTitle(QString(Q_FUNC_INFO));
-        msgBox.setIcon(QMessageBox::Critical);
-        msgBox.setText(QString("SendIFC() Error"));
-        msgBox.setInformativeText(QString("Is the GPIB Interface connected ? "));
-        msgBox.setStandardButtons(QMessageBox::Ok);
-        msgBox.setDefaultButton(QMessageBox::Ok);
-        int ret = msgBox.exec();
-        Q_UNUSED(ret)
-        return false;
-    }
-    // If addrlist contains only the constant NOADDR,
-    // the Universal Device Clear (DCL)
-    // message is sent to all the devices on the bus
-    Addr4882_t addrlist;
-    addrlist = NOADDR;
-    DevClearList(gpibBoardID, &addrlist);
-    if(ThreadIbsta() & ERR) {
-        QMessageBox msgBox;
-        msgBox.setWindowTitle(QString(Q_FUNC_INFO));
-        msgBox.setIcon(QMessageBox::Critical);
-        msgBox.setText(QString("DevClearList() failed"));
-        msgBox.setInformativeText(QString("Are the Instruments Connected and Switched On ?"));
-        msgBox.setStandardButtons(QMessageBox::Ok);
-        msgBox.setDefaultButton(QMessageBox::Ok);
-        int ret = msgBox.exec();
-        Q_UNUSED(ret)
-        return false;
-    }
-    Addr4882_t padlist[31];
-    Addr4882_t resultlist[31];
-    for(Addr4882_t i=0; i<30; i++) padlist[i] = i+1;
-    padlist[30] = NOADDR;
-    FindLstn(gpibBoardID, padlist, resultlist, 30);
-    if(ThreadIbsta() & ERR) {
-        QMessageBox msgBox;
-        msgBox.setWindowTitle(QString(Q_FUNC_INFO));
-        msgBox.setIcon(QMessageBox::Critical);
-        msgBox.setText(QString("FindLstn() failed"));
-        msgBox.setInformativeText(QString("Are the Instruments Connected and Switched On ?"));
-        msgBox.setStandardButtons(QMessageBox::Ok);
-        msgBox.setDefaultButton(QMessageBox::Ok);
-        int ret = msgBox.exec();
-        Q_UNUSED(ret)
-        return false;
-    }
-    int nDevices = ThreadIbcnt();
-    //qInfo() << QString("Found %1 Instruments connected to the GPIB Bus").arg(nDevices);
-
-    // Identify the instruments connected to the GPIB Bus
-    QString sCommand, sInstrumentID;
-    // Identify the instruments connected to the GPIB Bus
-    char readBuf[257];
-    for(int i=0; i<nDevices; i++) {
-        sCommand = "*IDN?";
-        Send(gpibBoardID, resultlist[i], sCommand.toUtf8().constData(), sCommand.length(), DABend);
-        if(ThreadIbsta() & ERR) {
-            QMessageBox msgBox;
-            msgBox.setWindowTitle(QString(Q_FUNC_INFO));
-            msgBox.setIcon(QMessageBox::Critical);
-            msgBox.setText(QString("*IDN? failed"));
-            msgBox.setInformativeText(QString("Are the Instruments Connected and Switched On ?"));
-            msgBox.setStandardButtons(QMessageBox::Ok);
-            msgBox.setDefaultButton(QMessageBox::Ok);
-            int ret = msgBox.exec();
-            Q_UNUSED(ret)
-            return false;
-        }
-        Receive(gpibBoardID, resultlist[i], readBuf, 256, STOPend);
-        if(ThreadIbsta() & ERR) {
-            QMessageBox msgBox;
-            msgBox.setWindowTitle(QString(Q_FUNC_INFO));
-            msgBox.setIcon(QMessageBox::Critical);
-            msgBox.setText(QString("Receive() failed"));
-            msgBox.setInformativeText(QString("Are the Instruments Connected and Switched On ?"));
-            msgBox.setStandardButtons(QMessageBox::Ok);
-            msgBox.setDefaultButton(QMessageBox::Ok);
-            int ret = msgBox.exec();
-            Q_UNUSED(ret)
-            return false;
-        }
-        readBuf[ThreadIbcnt()] = '\0';
-        sInstrumentID = QString(readBuf);
-        pStatusBar->showMessage(QString("Found %1 @ Address= %2")
-                                .arg(sInstrumentID)
-                                .arg(resultlist[i]));
-        if(sInstrumentID.contains("4284A", Qt::CaseInsensitive)) {
-            if(pHp4284a == nullptr) {
-                pHp4284a = new Hp4284a(gpibBoardID, resultlist[i], this);
-                connect(pHp4284a, SIGNAL(aMessage(QString)),
-                        this, SLOT(onGpibMessage(QString)));
-                connect(pHp4284a, SIGNAL(measurementComplete()),
-                        this, SLOT(onNew4284Measure()));
-                connect(pHp4284a, SIGNAL(correctionDone()),
-                        this, SLOT(onCorrectionDone()));
-            }
-        }
-    }
+// The instruments are searched by their own thread: the user interface
+// is usable in the meantime. Every HP4284A found on the GPIB boards can
+// be driven through the ControlServer; the first one is also driven by
+// the user interface.
+void
+MainWindow::startDiscovery(bool bFullScan) {
+    disableButtons(true);
+    pStatusBar->showMessage("Looking for the GPIB Instruments...");
+    pDiscovery->start(gpibBoards, bFullScan);
+}
+
+
+void
+MainWindow::onInstrumentFound(int board, int address, QString sIdn) {
+    pStatusBar->showMessage(QString("Found %1 @ GPIB%2 Address= %3")
+                            .arg(sIdn)
+                            .arg(board)
+                            .arg(address));
+    logMessage(QString("GPIB%1@%2: %3").arg(board).arg(address).arg(sIdn));
+}
+
+
+void
+MainWindow::onDiscoveryFinished(QString sError) {
     if(pHp4284a == nullptr) {
+        if(!sError.isEmpty())
+            logMessage(sError);
         int iAnswer = QMessageBox::warning(this,
                                            "Warning",
                                            "HP4284A LCR Meter Not Connected",
-                                           QMessageBox::Abort|QMessageBox::Ignore,
-                                           QMessageBox::Abort);
-        if(iAnswer == QMessageBox::Abort)
-            return false;
+                                           QMessageBox::Retry|QMessageBox::Ignore,
+                                           QMessageBox::Retry);
+        if(iAnswer == QMessageBox::Retry)
+            startDiscovery(true);
+        return;
     }
-    return true;
+    pStatusBar->showMessage(QString("Found %1 HP4284A").arg(pSessions->count()));
+    disableButtons(false);
+    checkInterruptedRun();
+}
+
+
+void
+MainWindow::setMainMeter(int iMeter) {
+    pHp4284a = pSessions->meter(iMeter);
+    connect(pHp4284a, SIGNAL(correctionDone()),
+            this, SLOT(onCorrectionDone()));
+    connect(pHp4284a, SIGNAL(mustExit()),
+            this, SLOT(onInstrumentError()));
+    pSweep = pSessions->sweep(iMeter);
+    connect(pSweep, SIGNAL(started()),
+            this, SLOT(onSweepStarted()));
+    connect(pSweep, SIGNAL(newPoints(QVector<RunRecord>)),
+            this, SLOT(onNewPoints(QVector<RunRecord>)));
+    connect(pSweep, SIGNAL(finished(bool)),
+            this, SLOT(onSweepFinished(bool)));
+    connect(pSweep, SIGNAL(stopped()),
+            this, SLOT(onSweepStopped()));
+    connect(pSweep, SIGNAL(message(QString)),
+            this, SLOT(onSweepMessage(QString)));
+}
+
+
+// The messages of all the meters go to the log file
+void
+MainWindow::onMeterAdded(int iMeter) {
+    if(pHp4284a == nullptr)
+        setMainMeter(iMeter);
+    connect(pSessions->meter(iMeter), SIGNAL(aMessage(QString)),
+            this, SLOT(onGpibMessage(QString)));
+    connect(pSessions->sweep(iMeter), SIGNAL(writeError(QString)),
+            this, SLOT(onWriterError(QString)));
+    connect(pSessions->sweep(iMeter), SIGNAL(finished(bool)),
+            this, SLOT(onSessionSweepFinished(bool)));
 }
 
 
@@ -383,14 +393,17 @@ MainWindow::initPlots() {
     pPlotE1_Om = new Plot2D(nullptr, "E'(F)");
     pPlotE2_Om = new Plot2D(nullptr, "E\"(F)");
     pPlotTD_Om = new Plot2D(nullptr, "Tan_Delta(F)");
+    pPlotDerived = new Plot2D(nullptr, "Derived(F)");
 
     pPlotE1_Om->SetLimits(10.0, 1.0e6, 1.0, 10.0, false, true, true, false);
     pPlotE2_Om->SetLimits(10.0, 1.0e6, 1.0, 10.0, false, true, true, false);
     pPlotTD_Om->SetLimits(10.0, 1.0e6, 1.0, 10.0, false, true, true, false);
+    pPlotDerived->SetLimits(10.0, 1.0e6, 1.0, 10.0, false, true, true, false);
 
     pPlotE1_Om->UpdatePlot();
     pPlotE2_Om->UpdatePlot();
     pPlotTD_Om->UpdatePlot();
+    pPlotDerived->UpdatePlot();
 
     if(pShowE1_F->isChecked())
         pPlotE1_Om->show();
@@ -406,6 +419,11 @@ MainWindow::initPlots() {
         pPlotTD_Om->show();
     else
         pPlotTD_Om->hide();
+
+    if(pShowDerived->isChecked())
+        pPlotDerived->show();
+    else
+        pPlotDerived->hide();
 }
 
 
@@ -416,52 +434,6 @@ MainWindow::onConfigure() {
 }
 
 
-bool
-MainWindow::prepareOutputFile(QString sBaseDir, QString sFileName) {
-    if(pOutputFile) {
-        pOutputFile->close();
-        pOutputFile->deleteLater();
-        pOutputFile = Q_NULLPTR;
-    }
-    pOutputFile = new QFile(sBaseDir + "/" + sFileName);
-    if(!pOutputFile->open(QIODevice::Text|QIODevice::WriteOnly)) {
-        QMessageBox::critical(this,
-                              "Error: Unable to Open Output File",
-                              QString("%1/%2")
-                              .arg(sBaseDir, sFileName));
-        pStatusBar->showMessage("Unable to Open Output file...");
-        return false;
-    }
-    return true;
-}
-
-
-void
-MainWindow::writeHeader() { // Write the File header
-    // To cope with the GnuPlot way to handle the comment lines
-    // we need a # as a first chraracter in each comment row.
-    pOutputFile->write(QString("%1 %2 %3 %4 %5\n")
-                           .arg("#Frequency[Hz]", 12)
-                           .arg("E1r", 12)
-                           .arg("E2r", 12)
-                           .arg("TanD", 12)
-                           .arg("Cp", 12)
-                           .toLocal8Bit());
-    pOutputFile->write(QString("#Area = %1mm^2 Thickness=%2mm C0=%3 F\n")
-                       .arg(pConfigureDlg->pTabFile->sSampleArea, 12)
-                       .arg(pConfigureDlg->pTabFile->sSampleThickness, 12)
-                       .arg(c0, 12)
-                       .toLocal8Bit());
-    QStringList HeaderLines = pConfigureDlg->pTabFile->sSampleInfo.split("\n");
-    for(int i=0; i<HeaderLines.count(); i++) {
-        pOutputFile->write("# ");
-        pOutputFile->write(HeaderLines.at(i).toLocal8Bit());
-        pOutputFile->write("\n");
-    }
-    pOutputFile->flush();
-}
-
-
 void
 MainWindow::onStartMeasure() {
     QString sTitle;
@@ -470,65 +442,153 @@ MainWindow::onStartMeasure() {
         endMeasure();
         return;
     }
-    if(pConfigureDlg->exec() == QDialog::Rejected)
+    if(checkInterruptedRun())
         return;
-    QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
-    disableButtons(true);
-    pStatusBar->showMessage("Initializing 4284a...");
-    repaint();
-    c0 = (e0*pConfigureDlg->pTabFile->sSampleArea.toDouble())/
-         (pConfigureDlg->pTabFile->sSampleThickness.toDouble());
-    c0 = c0 * 1.0e-3;
-    if(pHp4284a->init()) {
-        pStatusBar->showMessage("Unable to Initialize 4248a...");
-        disableButtons(false);
+    if(pConfigureDlg->exec() == QDialog::Rejected)
         return;
+    SweepConfig config;
+    config.area             = pConfigureDlg->pTabFile->sSampleArea.toDouble();
+    config.thickness        = pConfigureDlg->pTabFile->sSampleThickness.toDouble();
+    config.sSampleInfo      = pConfigureDlg->pTabFile->sSampleInfo;
+    config.testVoltage      = pConfigureDlg->pTab4284->getTestVoltage();
+    config.averages         = 0; // Left to the instrument setting
+    config.settlingPeriods  = pConfigureDlg->pTab4284->getSettlingPeriods();
+    config.bOpenCorrection  = pConfigureDlg->pTab4284->isOpenCorrectionEnabled();
+    config.bShortCorrection = pConfigureDlg->pTab4284->isShortCorrectionEnabled();
+    config.bBinaryTransfer  = pConfigureDlg->pTab4284->isBinaryTransferEnabled();
+    config.planMode         = pConfigureDlg->pTabFrequency->getMode();
+    config.fMin             = pConfigureDlg->pTabFrequency->getMinFrequency();
+    config.fMax             = pConfigureDlg->pTabFrequency->getMaxFrequency();
+    config.pointsPerDecade  = pConfigureDlg->pTabFrequency->getPointsPerDecade();
+    config.sFrequencyFile   = pConfigureDlg->pTabFrequency->getFileName();
+    config.extraPoints      = pConfigureDlg->pTabFrequency->getExtraPoints();
+    config.threshold        = pConfigureDlg->pTabFrequency->getThreshold();
+    config.sOutputFile      = pConfigureDlg->pTabFile->sBaseDir + "/" +
+                              pConfigureDlg->pTabFile->sOutFileName;
+    config.derivedQuantities = settings.value("derivedQuantities", QStringList()).toStringList();
+    QString sError;
+    if(!pSweep->start(config, &sError)) {
+        QMessageBox::critical(this,
+                              "Error: Unable to Start the Measure",
+                              sError);
+        pStatusBar->showMessage("Unable to Start the Measure...");
     }
-    pHp4284a->setMode(Hp4284a::CPD);
-    pStatusBar->showMessage("Initializing measurement frequencies...");
-    repaint();
-    pHp4284a->setAmplitude(pConfigureDlg->pTab4284->getTestVoltage());
-    pHp4284a->setOpenCorrection(pConfigureDlg->pTab4284->isOpenCorrectionEnabled());
-    pHp4284a->setShortCorrection(pConfigureDlg->pTab4284->isShortCorrectionEnabled());
+}
 
-    pStatusBar->showMessage("Initializing Plots...");
-    repaint();
+
+void
+MainWindow::initDataSets(int iPlotStyle) {
     pPlotE1_Om->ClearPlot();
     pPlotE2_Om->ClearPlot();
     pPlotTD_Om->ClearPlot();
+    pPlotDerived->ClearPlot();
 
-    pPlotE1_Om->NewDataSet(1, 3, QColor(0xFF, 0xFF, 0), Plot2D::iline, "E1(F)");
+    pPlotE1_Om->NewDataSet(1, 3, QColor(0xFF, 0xFF, 0), iPlotStyle, "E1(F)");
     pPlotE1_Om->SetShowDataSet(1, true);
 
-    pPlotE2_Om->NewDataSet(1, 3, QColor(0xFF, 0xFF, 0), Plot2D::iline, "E2(F)");
+    pPlotE2_Om->NewDataSet(1, 3, QColor(0xFF, 0xFF, 0), iPlotStyle, "E2(F)");
     pPlotE2_Om->SetShowDataSet(1, true);
 
-    pPlotTD_Om->NewDataSet(1, 3, QColor(0xFF, 0xFF, 0), Plot2D::iline, "TanD(F)");
+    pPlotTD_Om->NewDataSet(1, 3, QColor(0xFF, 0xFF, 0), iPlotStyle, "TanD(F)");
     pPlotTD_Om->SetShowDataSet(1, true);
 
-    pStatusBar->showMessage("Initializing Output File...");
-    repaint();
-    // Open the Output file
-    if(!prepareOutputFile(pConfigureDlg->pTabFile->sBaseDir,
-                          pConfigureDlg->pTabFile->sOutFileName))
-    {
-        pStatusBar->showMessage("Unable to Open the Output File...");
-        QApplication::restoreOverrideCursor();
-        disableButtons(false);
-        return;
+    pPlotDerived->NewDataSet(1, 3, QColor(0xFF, 0xFF, 0), iPlotStyle,
+                             DerivedQuantities::label(pDerivedCombo->currentIndex()) + "(F)");
+    pPlotDerived->SetShowDataSet(1, true);
+}
+
+
+// Asks to resume the measure left unfinished by the previous session
+// (or by an instrument error). Returns true if it has been resumed.
+bool
+MainWindow::checkInterruptedRun() {
+    if(pSweep == nullptr)
+        return false;
+    QString sFileName = pSweep->interruptedRun();
+    if(sFileName.isEmpty())
+        return false;
+    int iAnswer = QMessageBox::question(this,
+                                        "Interrupted Measure",
+                                        QString("The measure saved in\n%1\nhas not been completed.\n"
+                                                "Resume it ?").arg(sFileName),
+                                        QMessageBox::Yes|QMessageBox::No,
+                                        QMessageBox::Yes);
+    if(iAnswer != QMessageBox::Yes) {
+        pSweep->clearJournal();
+        return false;
     }
-    pStatusBar->showMessage("Writing File Header...");
-    repaint();
-    writeHeader();
+    pStatusBar->showMessage("Resuming the Interrupted Measure...");
+    QString sError;
+    if(!pSweep->resume(&sError)) {
+        QMessageBox::critical(this,
+                              "Error: Unable to Resume the Measure",
+                              sError);
+        return false;
+    }
+    return true;
+}
 
+
+// The measures can also be started through the ControlServer
+void
+MainWindow::onSweepStarted() {
+    QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+    disableButtons(true);
     startMeasureButton.setText("Stop");
-    currentFrequencyIndex = 0;
-    pHp4284a->setFrequency(frequencies.at(currentFrequencyIndex));
-    QThread::msleep(stabilizeTime);
-    pHp4284a->enableQuery();
-    pHp4284a->queryValues();
-    pStatusBar->showMessage(QString("Waiting data at f=%1Hz").arg(frequencies.at(currentFrequencyIndex)));
     startMeasureButton.setEnabled(true);
+    pStatusBar->showMessage("Initializing Plots...");
+    // The frequencies added by the adaptive plan arrive out of order:
+    // joining them with lines would be meaningless
+    initDataSets(pSweep->isAdaptive() ? Plot2D::ipoint : Plot2D::iline);
+}
+
+
+void
+MainWindow::onSweepFinished(bool bCompleted) {
+    onSweepStopped();
+    if(!bCompleted)
+        pStatusBar->showMessage("Measure Aborted: HP4284A Error");
+}
+
+
+// Every completed spectrum is analyzed, whatever meter measured it
+void
+MainWindow::onSessionSweepFinished(bool bCompleted) {
+    Sweep* pFinished = qobject_cast<Sweep*>(sender());
+    if(!bCompleted || !pFinished || !pAnalyzer)
+        return;
+    pAnalyzer->start(pFinished->points(), pFinished->currentConfig().sOutputFile);
+}
+
+
+// The sample is still mounted: an inconsistent
+// spectrum can be measured again at once.
+void
+MainWindow::onKkChecked(QString sSummary, int nFlagged) {
+    logMessage(sSummary);
+    pStatusBar->showMessage(sSummary);
+    if(nFlagged > 0)
+        QMessageBox::warning(this,
+                             "Kramers-Kronig Check",
+                             QString("The measured spectrum is not consistent:\n%1\n"
+                                     "Consider to repeat the measure.").arg(sSummary));
+}
+
+
+void
+MainWindow::onFitDone(QString sSummary) {
+    logMessage(sSummary);
+    pStatusBar->showMessage(sSummary.section('\n', 0, 1).replace('\n', ": "));
+}
+
+
+void
+MainWindow::onSweepStopped() {
+    startMeasureButton.setText("Start Measure");
+    disableButtons(false);
+    QApplication::restoreOverrideCursor();
+    pStatusBar->showMessage("Misura Terminata");
+    //iStatus = STATUS_IDLE;
 }
 
 
@@ -560,58 +620,79 @@ MainWindow::onShowTD() {
 
 
 void
-MainWindow::onNew4284Measure() {
-    QString sZvalues = pHp4284a->getValues();
-    QStringList sListVal = sZvalues.remove('\n').split(",");
-    if(sListVal.count() > 2) {
-        double f = frequencies[currentFrequencyIndex];
-        if(sListVal[2].toInt() == 0) {
-            double e1 = sListVal[0].toDouble()/c0;
-            double e2 = sListVal[1].toDouble()*e1;
-            pPlotE1_Om->NewPoint(1, f, e1);
-            pPlotE2_Om->NewPoint(1, f, e2);
-            pPlotTD_Om->NewPoint(1, f, sListVal[1].toDouble());
-            pPlotE1_Om->UpdatePlot();
-            pPlotE2_Om->UpdatePlot();
-            pPlotTD_Om->UpdatePlot();
-            QString sData = QString("%1 %2 %3 %4 %5\n")
-                            .arg(f, 12, 'g', 6, ' ')
-                            .arg(e1, 12, 'g', 6, ' ')
-                            .arg(e2, 12, 'g', 6, ' ')
-                            .arg(sListVal[1].toDouble(), 12, 'g', 6, ' ')
-                            .arg(sListVal[0].toDouble(), 12, 'g', 6, ' ');
-            pOutputFile->write(sData.toLocal8Bit());
-            pOutputFile->flush();
-//            qDebug() << "F=" << f << "Hz"
-//                     << "Cp=" << sListVal[0].toDouble() << "Farad"
-//                     << "TanD=" << sListVal[1].toDouble();
-        }
-    }
-    if(++currentFrequencyIndex >= nFrequencies) {
-        endMeasure();
+MainWindow::onShowDerived() {
+    if(pShowDerived->isChecked())
+        pPlotDerived->show();
+    else
+        pPlotDerived->hide();
+}
+
+
+// The whole spectrum measured so far is plotted again
+void
+MainWindow::onDerivedPlotChanged(int iQuantity) {
+    settings.setValue("derivedPlot", iQuantity);
+    if(pSweep == nullptr)
+        return;
+    pPlotDerived->DelDataSet(1);
+    pPlotDerived->NewDataSet(1, 3, QColor(0xFF, 0xFF, 0),
+                             pSweep->isAdaptive() ? Plot2D::ipoint : Plot2D::iline,
+                             DerivedQuantities::label(iQuantity) + "(F)");
+    pPlotDerived->SetShowDataSet(1, true);
+    plotDerived(pSweep->points());
+    pPlotDerived->UpdatePlot();
+}
+
+
+// The derivative loss needs the whole spectrum: it is computed
+// again, in a single batch, each time new points arrive.
+void
+MainWindow::plotDerived(const QVector<RunRecord>& points) {
+    int iQuantity = pDerivedCombo->currentIndex();
+    double c0 = pSweep->c0();
+    if(DerivedQuantities::isPointwise(iQuantity)) {
+        for(int i=0; i<points.count(); i++)
+            pPlotDerived->NewPoint(1, points.at(i).frequency,
+                                   DerivedQuantities::value(iQuantity, points.at(i), c0));
         return;
     }
-    pStatusBar->showMessage(QString("Waiting data at f=%1Hz").arg(frequencies[currentFrequencyIndex]));
-    repaint();
-    pHp4284a->setFrequency(frequencies[currentFrequencyIndex]);
-    QThread::msleep(stabilizeTime);
-    pHp4284a->queryValues();
+    QVector<RunRecord> spectrum = pSweep->points();
+    std::sort(spectrum.begin(), spectrum.end(), [](const RunRecord& a, const RunRecord& b) {
+        return a.frequency < b.frequency;
+    });
+    QVector<double> values = DerivedQuantities::batch(iQuantity, spectrum, c0);
+    pPlotDerived->ClearDataSet(1);
+    for(int i=0; i<spectrum.count(); i++)
+        pPlotDerived->NewPoint(1, spectrum.at(i).frequency, values.at(i));
 }
 
 
 void
-MainWindow::endMeasure() {
-    pHp4284a->disableQuery();
-    if(pOutputFile) {
-        pOutputFile->close();
-        pOutputFile->deleteLater();
-        pOutputFile = nullptr;
+MainWindow::onNewPoints(QVector<RunRecord> points) {
+    for(int i=0; i<points.count(); i++) {
+        const RunRecord& point = points.at(i);
+        pPlotE1_Om->NewPoint(1, point.frequency, point.e1);
+        pPlotE2_Om->NewPoint(1, point.frequency, point.e2);
+        pPlotTD_Om->NewPoint(1, point.frequency, point.d);
     }
-    startMeasureButton.setText("Start Measure");
-    disableButtons(false);
-    QApplication::restoreOverrideCursor();
-    pStatusBar->showMessage("Misura Terminata");
-    //iStatus = STATUS_IDLE;
+    plotDerived(points);
+    pPlotE1_Om->UpdatePlot();
+    pPlotE2_Om->UpdatePlot();
+    pPlotTD_Om->UpdatePlot();
+    pPlotDerived->UpdatePlot();
+}
+
+
+void
+MainWindow::onSweepMessage(QString sMessage) {
+    pStatusBar->showMessage(sMessage);
+}
+
+
+void
+MainWindow::endMeasure() {
+    if(pSweep)
+        pSweep->stop(); // See onSweepStopped()
 }
 
 // The correction function has two kinds of correction methods.
@@ -638,15 +719,15 @@ MainWindow::onOpenCorrection() {
     if(openCorrectionDialog.exec() != QDialog::Accepted)
         return;
     pStatusBar->showMessage("Initializing 4284a...");
-    repaint();
-    if(pHp4284a->init()) {
-        return;
-    }
-    pHp4284a->setMode(Hp4284a::CPD);
-    pHp4284a->setAmplitude(2.0);
+    Hp4284a* pMeter = pHp4284a;
+    pHp4284a->post([pMeter]() {
+        if(pMeter->init())
+            return;
+        pMeter->setMode(Hp4284a::CPD);
+        pMeter->setAmplitude(2.0);
+        pMeter->openCorrection();
+    });
     QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
-    if(!pHp4284a->openCorrection())
-        return;
     disableButtons(true);
     openCorrectionButton.setEnabled(true);
     openCorrectionButton.setText("Stop");
@@ -668,16 +749,15 @@ MainWindow::onShortCorrection() {
     if(shortCorrectionDialog.exec() != QDialog::Accepted)
         return;
     pStatusBar->showMessage("Initializing 4284a...");
-    repaint();
-    if(pHp4284a->init()) {
-        return;
-    }
-    pHp4284a->setMode(Hp4284a::CPD);
-    pHp4284a->setAmplitude(2.0);
-
+    Hp4284a* pMeter = pHp4284a;
+    pHp4284a->post([pMeter]() {
+        if(pMeter->init())
+            return;
+        pMeter->setMode(Hp4284a::CPD);
+        pMeter->setAmplitude(2.0);
+        pMeter->shortCorrection();
+    });
     QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
-    if(!pHp4284a->shortCorrection())
-        return;
     disableButtons(true);
     shortCorrectionButton.setEnabled(true);
     shortCorrectionButton.setText("Stop");
@@ -729,7 +809,11 @@ MainWindow::OnLoadCorr() {
 
 void
 MainWindow::onCorrectionDone() {
-    pHp4284a->closeCorrection();
+    pHp4284a->clearQueue();
+    Hp4284a* pMeter = pHp4284a;
+    pHp4284a->post([pMeter]() {
+        pMeter->closeCorrection();
+    });
     openCorrectionButton.setText("Open Corr.");
     shortCorrectionButton.setText("Short Corr.");
     pStatusBar->showMessage("Correction Done !");
@@ -738,7 +822,28 @@ MainWindow::onCorrectionDone() {
 }
 
 
+// Any unrecoverable instrument error aborts the operation in progress
+// (the measures are aborted by the Sweep, see onSweepFinished()).
+// It can be signaled more than once for the same failure.
+void
+MainWindow::onInstrumentError() {
+    if((openCorrectionButton.text()  == "Stop") ||
+       (shortCorrectionButton.text() == "Stop"))
+    {
+        onCorrectionDone();
+        pStatusBar->showMessage("Correction Aborted: HP4284A Error");
+    }
+}
+
+
 void
 MainWindow::onGpibMessage(QString sMessage) {
     logMessage(sMessage);
 }
+
+
+void
+MainWindow::onWriterError(QString sError) {
+    pStatusBar->showMessage("Error writing the Output file...");
+    logMessage(sError);
+}
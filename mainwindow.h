@@ -31,9 +31,15 @@
 #include <QComboBox>
 #include <QTextEdit>
 
+#include "hp4284a.h"
+#include "datawriter.h"
+#include "sweep.h"
+#include "controlserver.h"
+#include "sessionmanager.h"
+#include "instrumentdiscovery.h"
+#include "spectrumanalyzer.h"
+
 
-QT_FORWARD_DECLARE_CLASS(QFile)
-QT_FORWARD_DECLARE_CLASS(Hp4284a)
 QT_FORWARD_DECLARE_CLASS(Plot2D)
 QT_FORWARD_DECLARE_CLASS(QGridLayout)
 QT_FORWARD_DECLARE_CLASS(ConfigureDlg)
@@ -46,23 +52,38 @@ class MainWindow : public QMainWindow//QDialog
     Q_OBJECT
 
 public:
-    explicit MainWindow(int iBoard, QWidget *parent = nullptr);
+    explicit MainWindow(QVector<int> boards, QWidget *parent = nullptr);
     ~MainWindow() override;
 
 public:
-    bool checkInstruments();
+    void startDiscovery(bool bFullScan);
     void updateUserInterface();
+    bool checkInterruptedRun();
 
 
 public slots:
     void onConfigure();
     void onStartMeasure();
-    void onNew4284Measure();
+    void onNewPoints(QVector<RunRecord> points);
+    void onSweepStarted();
+    void onSweepFinished(bool bCompleted);
+    void onSweepStopped();
+    void onSweepMessage(QString sMessage);
+    void onMeterAdded(int iMeter);
+    void onInstrumentFound(int board, int address, QString sIdn);
+    void onDiscoveryFinished(QString sError);
+    void onFitDone(QString sSummary);
+    void onSessionSweepFinished(bool bCompleted);
+    void onKkChecked(QString sSummary, int nFlagged);
     void onCorrectionDone();
+    void onInstrumentError();
     void onShowE1();
     void onShowE2();
     void onShowTD();
+    void onShowDerived();
+    void onDerivedPlotChanged(int iQuantity);
     void onGpibMessage(QString sMessage);
+    void onWriterError(QString sError);
     void onOpenCorrection();
     void onShortCorrection();
 
@@ -80,24 +101,32 @@ protected:
     bool prepareLogFile();
     void logMessage(QString sMessage);
     void endMeasure();
-    bool prepareOutputFile(QString sBaseDir, QString sFileName);
-    void writeHeader();
+    void setMainMeter(int iMeter);
+    void initDataSets(int iPlotStyle);
     void disableButtons(bool bDisable);
+    void plotDerived(const QVector<RunRecord>& points);
 
 private:
     QGridLayout*     pMainLayout;
-    QFile*           pOutputFile;
-    QFile*           pLogFile;
+    DataWriter*      pLogWriter;
     Hp4284a*         pHp4284a;
+    Sweep*           pSweep;
+    SessionManager*  pSessions;
+    ControlServer*   pControlServer;
+    InstrumentDiscovery* pDiscovery;
+    SpectrumAnalyzer* pAnalyzer;
     Plot2D*          pPlotE1_Om;
     Plot2D*          pPlotE2_Om;
     Plot2D*          pPlotTD_Om;
+    Plot2D*          pPlotDerived;
     ConfigureDlg*    pConfigureDlg;
     QCheckBox*       pShowE1_F;
     QCheckBox*       pShowE2_F;
     QCheckBox*       pShowTD_F;
+    QCheckBox*       pShowDerived;
+    QComboBox*       pDerivedCombo;
     QStatusBar*      pStatusBar;
-    int              gpibBoardID;
+    QVector<int>     gpibBoards;
     bool	         bPlotE1_Om;
     bool	         bPlotE2_Om;
     bool	         bPlotTD_Om;
@@ -111,10 +140,4 @@ private:
     QString          sErrorStyle;
     QString          sLogFileName;
     QString          sLogDir;
-    int              nFrequencies;
-    int              currentFrequencyIndex;
-    const double     e0;
-    double           c0;
-    QVector<double>  frequencies;
-    uint             stabilizeTime;
 };
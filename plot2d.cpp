@@ -24,8 +24,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QSettings>
 #include <QPainter>
 #include <QCloseEvent>
+#include <QResizeEvent>
 #include <QDebug>
 #include <QIcon>
+#include <QtNumeric>
 
 
 Plot2D::Plot2D(QWidget *parent, QString Title)
@@ -45,10 +47,14 @@ Plot2D::Plot2D(QWidget *parent, QString Title)
     yMarker      = 0.0;
     bShowMarker  = false;
     bZooming     = false;
+    bStaticLayerValid = false;
+    transformSerial   = 0;
+    transformX = {false, 0.0, 0.0, 0.0};
+    transformY = {false, 0.0, 0.0, 0.0};
 
     pPropertiesDlg = new plotPropertiesDlg(sTitle);
     connect(pPropertiesDlg, SIGNAL(configChanged()),
-            this, SLOT(UpdatePlot()));
+            this, SLOT(onConfigChanged()));
 
     labelPen = pPropertiesDlg->labelColor;//QPen(Qt::white);
     gridPen  = pPropertiesDlg->gridColor; //QPen(Qt::blue);
@@ -70,12 +76,14 @@ Plot2D::~Plot2D() {
     while(!dataSetList.isEmpty()) {
         delete dataSetList.takeFirst();
     }
+    dataSetById.clear();
 }
 
 
 void
 Plot2D::setTitle(QString sNewTitle) {
     sTitle = sNewTitle;
+    bStaticLayerValid = false;
 }
 
 
@@ -101,7 +109,7 @@ Plot2D::paintEvent(QPaintEvent *event) {
     painter.begin(this);
     painter.setFont(pPropertiesDlg->painterFont);
     QFontMetrics fontMetrics = painter.fontMetrics();
-    painter.fillRect(event->rect(), QBrush(pPropertiesDlg->painterBkColor));
+    Q_UNUSED(event)
     DrawPlot(&painter, fontMetrics);
     QRect textSize = fontMetrics.boundingRect(sMouseCoord);
     int nPosX = (width()/2) - (textSize.width()/2);
@@ -112,6 +120,13 @@ Plot2D::paintEvent(QPaintEvent *event) {
 }
 
 
+void
+Plot2D::resizeEvent(QResizeEvent *event) {
+    bStaticLayerValid = false;
+    QWidget::resizeEvent(event);
+}
+
+
 QSize
 Plot2D::minimumSizeHint() const {
    return QSize(50, 50);
@@ -126,7 +141,7 @@ Plot2D::sizeHint() const {
 
 void
 Plot2D::setMaxPoints(int nPoints) {
-    if(nPoints > 0) pPropertiesDlg->maxDataPoints = nPoints;
+    if(nPoints >= 0) pPropertiesDlg->maxDataPoints = nPoints;
     for(int pos=0; pos<dataSetList.count(); pos++) {
         dataSetList.at(pos)->setMaxPoints(pPropertiesDlg->maxDataPoints);
     }
@@ -171,7 +186,7 @@ Plot2D::SetLimits (double XMin, double XMax, double YMin, double YMax,
             for(int pos=0; pos<dataSetList.count(); pos++) {
                 pData = dataSetList.at(pos);
                 if(pData->isShown) {
-                    if(pData->m_pointArrayX.count() != 0) {
+                    if(pData->count() != 0) {
                         EmptyData = false;
                         if(Ax.AutoX) {
                             if(XMin > pData->minx) {
@@ -238,49 +253,57 @@ Plot2D::NewDataSet(int Id, int PenWidth, QColor Color, int Symbol, QString Title
     DataStream2D* pDataItem = new DataStream2D(Id, PenWidth, Color, Symbol, Title);
     pDataItem->setMaxPoints(pPropertiesDlg->maxDataPoints);
     dataSetList.append(pDataItem);
+    // With duplicated Ids the first data set is the one addressed
+    if(!dataSetById.contains(Id))
+        dataSetById.insert(Id, pDataItem);
     return pDataItem;
 }
 
 
+DataStream2D*
+Plot2D::FindDataSet(int Id) {
+    return dataSetById.value(Id, Q_NULLPTR);
+}
+
+
 bool
-Plot2D::ClearDataSet(int Id) {
-    bool bResult = false;
+Plot2D::DelDataSet(int Id) {
+    DataStream2D* pDataItem = FindDataSet(Id);
+    if(!pDataItem) return false;
+    dataSetList.removeOne(pDataItem);
+    dataSetById.remove(Id);
+    delete pDataItem;
     for(int i=0; i<dataSetList.count(); i++) {
-        DataStream2D* pDataItem = dataSetList.at(i);
-        if(pDataItem->GetId() == Id) {
-            pDataItem->RemoveAllPoints();
-            bResult = true;
+        if(dataSetList.at(i)->GetId() == Id) {
+            dataSetById.insert(Id, dataSetList.at(i));
+            break;
         }
     }
-    return bResult;
+    return true;
+}
+
+
+bool
+Plot2D::ClearDataSet(int Id) {
+    DataStream2D* pDataItem = FindDataSet(Id);
+    if(!pDataItem) return false;
+    pDataItem->RemoveAllPoints();
+    return true;
 }
 
 
 void
 Plot2D::SetShowDataSet(int Id, bool Show) {
-    if(!dataSetList.isEmpty()) {
-        for(int pos=0; pos<dataSetList.count(); pos++) {
-            DataStream2D* pData = dataSetList.at(pos);
-            if(pData->GetId() == Id) {
-                pData->SetShow(Show);
-                break;
-            }
-        }
-    }
+    DataStream2D* pData = FindDataSet(Id);
+    if(pData)
+        pData->SetShow(Show);
 }
 
 
 void
 Plot2D::NewPoint(int Id, double x, double y) {
     if(std::isnan(y)) return;
-    if(dataSetList.isEmpty())  return;
-    DataStream2D* pData = Q_NULLPTR;
-    for(int pos=0; pos<dataSetList.count(); pos++) {
-        if(dataSetList.at(pos)->GetId() == Id) {
-            pData = dataSetList.at(pos);
-            break;
-        }
-    }
+    DataStream2D* pData = FindDataSet(Id);
     if(pData) {
         pData->AddPoint(x, y);
     }
@@ -294,9 +317,10 @@ Plot2D::DrawData(QPainter* painter, QFontMetrics fontMetrics) {
     for(int pos=0; pos<dataSetList.count(); pos++) {
         pData = dataSetList.at(pos);
         if(pData->isShown) {
-            if(pData->GetProperties().Symbol == iline) {
+            int iSymbol = pData->GetProperties().Symbol;
+            if(iSymbol == iline) {
                 LinePlot(painter, pData);
-            } else if(pData->GetProperties().Symbol == ipoint) {
+            } else if(iSymbol == ipoint) {
                 PointPlot(painter, pData);
             } else {
                 ScatterPlot(painter, pData);
@@ -309,15 +333,9 @@ Plot2D::DrawData(QPainter* painter, QFontMetrics fontMetrics) {
 
 void
 Plot2D::SetShowTitle(int Id, bool show) {
-    if(dataSetList.isEmpty()) return;
-    DataStream2D* pData;
-    for(int pos=0; pos<dataSetList.count(); pos++) {
-        pData = dataSetList.at(pos);
-        if(pData->GetId() == Id) {
-            pData->SetShowTitle(show);
-            return;
-        }
-    }
+    DataStream2D* pData = FindDataSet(Id);
+    if(pData)
+        pData->SetShowTitle(show);
 }
 
 
@@ -643,6 +661,40 @@ Plot2D::DrawFrame(QPainter* painter, QFontMetrics fontMetrics) {
 }
 
 
+// Renders the background and the frame (with grid, tics and title)
+// into staticLayer. It also computes xfact and yfact, so it has to
+// be called before drawing the data whenever the limits change.
+void
+Plot2D::DrawStaticLayer(QFontMetrics fontMetrics) {
+    qreal dpr = devicePixelRatioF();
+    staticLayer = QPixmap(size()*dpr);
+    staticLayer.setDevicePixelRatio(dpr);
+    staticLayer.fill(pPropertiesDlg->painterBkColor);
+    QPainter painter(&staticLayer);
+    painter.setFont(pPropertiesDlg->painterFont);
+    DrawFrame(&painter, fontMetrics);
+    painter.end();
+    // The Tic functions may adjust the limits
+    staticLimits = Ax;
+    bStaticLayerValid = true;
+    if(Ax.XMin > 0.0)
+        xLogMin = log10(Ax.XMin);
+    else
+        xLogMin = double(FLT_MIN);
+    if(Ax.YMin > 0.0)
+        yLogMin = log10(Ax.YMin);
+    else
+        yLogMin = double(FLT_MIN);
+}
+
+
+static bool
+sameAxis(const PlotTransform::Axis& a, const PlotTransform::Axis& b) {
+    return (a.bLog == b.bLog) && (a.origin == b.origin) &&
+           (a.scale == b.scale) && (a.offset == b.offset);
+}
+
+
 void
 Plot2D::DrawPlot(QPainter* painter, QFontMetrics fontMetrics) {
     if(Ax.AutoX || Ax.AutoY) {
@@ -654,7 +706,23 @@ Plot2D::DrawPlot(QPainter* painter, QFontMetrics fontMetrics) {
     Pf.top = 2.0 * fontMetrics.height();
     Pf.bottom = height() - 3.0*fontMetrics.height();
 
-    DrawFrame(painter, fontMetrics);
+    if(!bStaticLayerValid ||
+       (Ax.XMin != staticLimits.XMin) || (Ax.XMax != staticLimits.XMax) ||
+       (Ax.YMin != staticLimits.YMin) || (Ax.YMax != staticLimits.YMax) ||
+       (Ax.LogX != staticLimits.LogX) || (Ax.LogY != staticLimits.LogY))
+    {
+        DrawStaticLayer(fontMetrics);
+    }
+    // The cached screen points are dropped only if the
+    // limits or the frame have really changed
+    PlotTransform::Axis xAxis = XAxis();
+    PlotTransform::Axis yAxis = YAxis();
+    if(!sameAxis(xAxis, transformX) || !sameAxis(yAxis, transformY)) {
+        transformX = xAxis;
+        transformY = yAxis;
+        transformSerial++;
+    }
+    painter->drawPixmap(0, 0, staticLayer);
     DrawData(painter, fontMetrics);
     if(bZooming) {
         QPen zoomPen(Qt::yellow);
@@ -666,209 +734,243 @@ Plot2D::DrawPlot(QPainter* painter, QFontMetrics fontMetrics) {
 }
 
 
-void
-Plot2D::LinePlot(QPainter* painter, DataStream2D* pData) {
-    if(!pData->isShown) return;
-    int iMax = int(pData->m_pointArrayX.count());
-    if(iMax == 0) return;
-    QPen dataPen = QPen(pData->GetProperties().Color);
-    dataPen.setWidth(pData->GetProperties().PenWidth);
-    painter->setPen(dataPen);
-    int ix0, iy0, ix1, iy1;
-    double xlmin, ylmin;
-    if(Ax.XMin > 0.0)
-        xlmin = log10(Ax.XMin);
-    else
-        xlmin = double(FLT_MIN);
-    if(Ax.YMin > 0.0)
-        ylmin = log10(Ax.YMin);
-    else ylmin = double(FLT_MIN);
+// Parameters of the data to screen transform (see PlotTransform)
+PlotTransform::Axis
+Plot2D::XAxis() {
+    PlotTransform::Axis axis;
+    axis.bLog   = Ax.LogX;
+    axis.origin = Ax.LogX ? xLogMin : Ax.XMin;
+    axis.scale  = xfact;
+    axis.offset = Pf.left;
+    return axis;
+}
 
-    if(Ax.LogX) {
-        if(pData->m_pointArrayX[0] > 0.0)
-            ix0 = int((Pf.left + (log10(pData->m_pointArrayX[0]) - xlmin)*xfact));
-        else
-            ix0 =-INT_MAX; // Solo per escludere il punto
-    } else
-        ix0 = int((Pf.left + (pData->m_pointArrayX[0] - Ax.XMin)*xfact));
 
-    if(Ax.LogY) {
-        if(pData->m_pointArrayY[0] > 0.0)
-            iy0 = int((Pf.bottom + (log10(pData->m_pointArrayY[0]) - ylmin)*yfact));
-        else
-            iy0 =-INT_MAX; // Solo per escludere il punto
-    } else
-        iy0 = int((Pf.bottom + (pData->m_pointArrayY[0] - Ax.YMin)*yfact));
+PlotTransform::Axis
+Plot2D::YAxis() {
+    PlotTransform::Axis axis;
+    axis.bLog   = Ax.LogY;
+    axis.origin = Ax.LogY ? yLogMin : Ax.YMin;
+    axis.scale  = yfact;
+    axis.offset = Pf.bottom;
+    return axis;
+}
 
-    for(int i=1; i<iMax; i++) {
-        if(Ax.LogX)
-            ix1 = int(((log10(pData->m_pointArrayX[i]) - xlmin)*xfact) + Pf.left);
-        else
-            ix1 = int(((pData->m_pointArrayX[i] - Ax.XMin)*xfact) + Pf.left);
-        if(Ax.LogY)
-            if(pData->m_pointArrayY[i] > 0.0)
-                iy1 = int((Pf.bottom + (log10(pData->m_pointArrayY[i]) - ylmin)*yfact));
-            else
-                iy1 =-INT_MAX; // Solo per escludere il punto
-        else
-            iy1 = int((Pf.bottom + (pData->m_pointArrayY[i] - Ax.YMin)*yfact));
 
-        if(!(ix1<Pf.left || iy1<Pf.top || iy1>Pf.bottom)) {
-            painter->drawLine(ix0, iy0, ix1, iy1);
+// Maps a data point to screen coordinates. Points that cannot
+// be shown (i.e. <= 0 on a log axis) have NaN coordinates.
+QPointF
+Plot2D::ToScreen(double x, double y) {
+    return QPointF(PlotTransform::toScreen(x, XAxis()),
+                   PlotTransform::toScreen(y, YAxis()));
+}
+
+
+// Maps the data points to screen coordinates. The result is kept
+// in the data set and only the points added since the last call
+// are transformed, unless the limits or the frame have changed.
+// The points dropped from the data set are removed from the front.
+void
+Plot2D::TransformData(DataStream2D* pData) {
+    qint64 first = pData->firstSequence();
+    if((pData->screenSerial != transformSerial) || (first < pData->screenFirst)) {
+        pData->screenPoints.clear();
+        pData->screenSerial = transformSerial;
+    } else if(first > pData->screenFirst) {
+        // Drop the points removed from the data set
+        pData->screenPoints.remove(0, int(qMin(first-pData->screenFirst, qint64(pData->screenPoints.count()))));
+    }
+    pData->screenFirst = first;
+    int iStart = int(pData->screenPoints.count());
+    int iMax = pData->count();
+    if(iStart == iMax) return;
+    pData->screenPoints.resize(iMax);
+    QPointF* pOut = pData->screenPoints.data();
+    PlotTransform::Axis xAxis = XAxis();
+    PlotTransform::Axis yAxis = YAxis();
+    // At most two runs: up to the end of the circular buffer and after
+    for(int i=iStart; i<iMax; ) {
+        int n = pData->contiguousCount(i);
+        PlotTransform::toScreen(pData->xData(i), pData->yData(i), n, xAxis, yAxis, pOut+i);
+        i += n;
+    }
+}
+
+
+// Clips the segment p0-p1 to the plot frame (Liang-Barsky).
+// Returns false if the segment lies completely outside.
+bool
+Plot2D::ClipSegment(QPointF& p0, QPointF& p1) {
+    double dx = p1.x() - p0.x();
+    double dy = p1.y() - p0.y();
+    double p[4] = {-dx, dx, -dy, dy};
+    double q[4] = {p0.x()-Pf.left, Pf.right-p0.x(), p0.y()-Pf.top, Pf.bottom-p0.y()};
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for(int i=0; i<4; i++) {
+        if(p[i] == 0.0) {
+            if(q[i] < 0.0) return false;
+            continue;
         }
-        ix0 = ix1;
-        iy0 = iy1;
-        if(ix1 > Pf.right) {
-            break;
+        double t = q[i] / p[i];
+        if(p[i] < 0.0) {
+            if(t > t1) return false;
+            if(t > t0) t0 = t;
+        } else {
+            if(t < t0) return false;
+            if(t < t1) t1 = t;
         }
     }
-    DrawLastPoint(painter, pData);
+    QPointF start = p0;
+    if(t1 < 1.0) p1 = QPointF(start.x()+t1*dx, start.y()+t1*dy);
+    if(t0 > 0.0) p0 = QPointF(start.x()+t0*dx, start.y()+t0*dy);
+    return true;
 }
 
 
+// Draws the segments joining consecutive points. The visible ones
+// are joined in a single polyline, broken only where the curve
+// leaves the frame or a point is NaN.
 void
-Plot2D::DrawLastPoint(QPainter* painter, DataStream2D* pData) {
-    if(!pData->isShown) return;
-    int ix, iy, i;
-    i = int(pData->m_pointArrayX.count()-1);
+Plot2D::DrawPolyline(QPainter* painter, const QPolygonF& points) {
+    QPolygonF polyline;
+    polyline.reserve(points.count());
+    QPointF p0, p1;
+    for(int i=1; i<points.count(); i++) {
+        p0 = points.at(i-1);
+        p1 = points.at(i);
+        bool bVisible = !(std::isnan(p0.x()) || std::isnan(p0.y()) ||
+                          std::isnan(p1.x()) || std::isnan(p1.y()));
+        if(bVisible)
+            bVisible = ClipSegment(p0, p1);
+        if(!bVisible || (!polyline.isEmpty() && (polyline.last() != p0))) {
+            if(polyline.count() > 1)
+                painter->drawPolyline(polyline);
+            polyline.clear();
+        }
+        if(!bVisible) continue;
+        if(polyline.isEmpty())
+            polyline.append(p0);
+        polyline.append(p1);
+    }
+    if(polyline.count() > 1)
+        painter->drawPolyline(polyline);
+}
 
-    double xlmin, ylmin;
-    if(Ax.XMin > 0.0)
-        xlmin = log10(Ax.XMin);
-    else
-        xlmin = double(FLT_MIN);
-    if(Ax.YMin > 0.0)
-        ylmin = log10(Ax.YMin);
-    else ylmin = double(FLT_MIN);
 
-    if(Ax.LogX) {
-        if(pData->m_pointArrayX[i] > 0.0)
-            ix = int(((log10(pData->m_pointArrayX[i]) - xlmin)*xfact) + Pf.left);
-        else
-            return;
+void
+Plot2D::LinePlot(QPainter* painter, DataStream2D* pData) {
+    if(!pData->isShown) return;
+    int iMax = pData->count();
+    if(iMax == 0) return;
+    const DataSetProperties& properties = pData->GetProperties();
+    QPen dataPen = QPen(properties.Color);
+    dataPen.setWidth(properties.PenWidth);
+    painter->setPen(dataPen);
+    int nBuckets = int(Pf.right-Pf.left) + 1;
+    if(pData->isSortedX() && (iMax > LOD_POINTS_PER_PIXEL*nBuckets)) {
+        // Too many points: draw only the visible ones, decimated
+        // with the min/max pyramid, so the cost depends on the
+        // frame width and not on the number of points.
+        int iFirst, iLast;
+        pData->GetVisibleRange(Ax.XMin, Ax.XMax, iFirst, iLast);
+        QVector<int> indices;
+        pData->GetLodIndices(iFirst, iLast, nBuckets, indices);
+        QVector<double> x(indices.count()), y(indices.count());
+        for(int i=0; i<indices.count(); i++) {
+            x[i] = pData->x(indices.at(i));
+            y[i] = pData->y(indices.at(i));
+        }
+        QPolygonF points(indices.count());
+        PlotTransform::toScreen(x.constData(), y.constData(), int(x.count()),
+                                XAxis(), YAxis(), points.data());
+        DrawPolyline(painter, points);
     } else {
-        ix = int(((pData->m_pointArrayX[i] - Ax.XMin)*xfact) + Pf.left);
+        TransformData(pData);
+        DrawPolyline(painter, pData->screenPoints);
     }
-    if(Ax.LogY) {
-        if(pData->m_pointArrayY[i] > 0.0)
-            iy = int((Pf.bottom + (log10(pData->m_pointArrayY[i]) - ylmin)*yfact));
-        else
-            return;
-    }
-    else {
-        iy = int((Pf.bottom + (pData->m_pointArrayY[i] - Ax.YMin)*yfact));
-    }
-    if(ix<=Pf.right && ix>=Pf.left && iy>=Pf.top && iy<=Pf.bottom)
-        painter->drawPoint(ix, iy);
-    return;
+    DrawLastPoint(painter, pData);
+}
+
+
+void
+Plot2D::DrawLastPoint(QPainter* painter, DataStream2D* pData) {
+    if(!pData->isShown) return;
+    int i = pData->count() - 1;
+    if(i < 0) return;
+    QPointF point = ToScreen(pData->x(i), pData->y(i));
+    if(point.x()<=Pf.right && point.x()>=Pf.left && point.y()>=Pf.top && point.y()<=Pf.bottom)
+        painter->drawPoint(point);
 }
 
 
 void
 Plot2D::PointPlot(QPainter* painter, DataStream2D* pData) {
-    int iMax = int(pData->m_pointArrayX.count());
+    int iMax = pData->count();
     if(iMax == 0) return;
-    QPen dataPen = QPen(pData->GetProperties().Color);
-    dataPen.setWidth(pData->GetProperties().PenWidth);
+    const DataSetProperties& properties = pData->GetProperties();
+    QPen dataPen = QPen(properties.Color);
+    dataPen.setWidth(properties.PenWidth);
     painter->setPen(dataPen);
-    int ix, iy;
-    double xlmin, ylmin;
-    if(Ax.XMin > 0.0)
-        xlmin = log10(Ax.XMin);
-    else
-        xlmin = double(FLT_MIN);
-    if(Ax.YMin > 0.0)
-        ylmin = log10(Ax.YMin);
-    else ylmin = double(FLT_MIN);
-
-    for (int i=0; i < iMax; i++) {
-        if(!(pData->m_pointArrayX[i] < Ax.XMin ||
-             pData->m_pointArrayX[i] > Ax.XMax ||
-             pData->m_pointArrayY[i] < Ax.YMin ||
-             pData->m_pointArrayY[i] > Ax.YMax ))
-        {
-            if(Ax.LogX) {
-                if(pData->m_pointArrayX[i] > 0.0)
-                    ix = int(((log10(pData->m_pointArrayX[i]) - xlmin)*xfact) + Pf.left);
-                else
-                    ix = -INT_MAX;
-            } else
-                ix = int(((pData->m_pointArrayX[i] - Ax.XMin)*xfact) + Pf.left);
-            if(Ax.LogY) {
-                if(pData->m_pointArrayY[i] > 0.0)
-                    iy = int((Pf.bottom + (log10(pData->m_pointArrayY[i]) - ylmin)*yfact));
-                else
-                    iy =-INT_MAX; // Solo per escludere il punto
-            } else
-                iy = int((Pf.bottom + (pData->m_pointArrayY[i] - Ax.YMin)*yfact));
-            painter->drawPoint(ix, iy);
-        }
-    }//for (int i=0; i <= iMax; i++)
+    TransformData(pData);
+    const QPolygonF& points = pData->screenPoints;
+    QPolygonF visible;
+    visible.reserve(iMax);
+    for(int i=0; i<iMax; i++) {
+        const QPointF& point = points.at(i);
+        // NaN coordinates fail all the comparisons
+        if(point.x()<=Pf.right && point.x()>=Pf.left && point.y()>=Pf.top && point.y()<=Pf.bottom)
+            visible.append(point);
+    }
+    painter->drawPoints(visible);
 }
 
 
 void
 Plot2D::ScatterPlot(QPainter* painter, DataStream2D* pData) {
-    int iMax = int(pData->m_pointArrayX.count());
+    int iMax = pData->count();
     if(iMax == 0) return;
-    QPen dataPen = QPen(pData->GetProperties().Color);
-    dataPen.setWidth(pData->GetProperties().PenWidth);
+    const DataSetProperties& properties = pData->GetProperties();
+    QPen dataPen = QPen(properties.Color);
+    dataPen.setWidth(properties.PenWidth);
     painter->setPen(dataPen);
+    TransformData(pData);
+    const QPolygonF& points = pData->screenPoints;
     int ix, iy;
 
-    double xlmin, ylmin;
-    if(Ax.XMin > 0.0)
-        xlmin = log10(Ax.XMin);
-    else
-        xlmin = double(FLT_MIN);
-    if(Ax.YMin > 0.0)
-        ylmin = log10(Ax.YMin);
-    else ylmin = double(FLT_MIN);
-
     int SYMBOLS_DIM = 8;
     QSize Size(SYMBOLS_DIM, SYMBOLS_DIM);
 
     for (int i=0; i < iMax; i++) {
-        if(pData->m_pointArrayX[i] >= Ax.XMin &&
-           pData->m_pointArrayX[i] <= Ax.XMax &&
-           pData->m_pointArrayY[i] >= Ax.YMin &&
-           pData->m_pointArrayY[i] <= Ax.YMax)
+        const QPointF& point = points.at(i);
+        if(point.x() >= Pf.left &&
+           point.x() <= Pf.right &&
+           point.y() >= Pf.top &&
+           point.y() <= Pf.bottom)
         {
-            if(Ax.LogX)
-                if(pData->m_pointArrayX[i] > 0.0)
-                    ix = int(((log10(pData->m_pointArrayX[i]) - xlmin)*xfact) + Pf.left);
-                else
-                    ix = -INT_MAX;
-            else//Asse X Lineare
-                ix= int(((pData->m_pointArrayX[i] - Ax.XMin)*xfact) + Pf.left);
-            if(Ax.LogY) {
-                if(pData->m_pointArrayY[i] > 0.0)
-                    iy = int(((log10(pData->m_pointArrayY[i]) - ylmin)*yfact) + Pf.bottom);
-                else
-                    iy =-INT_MAX; // Solo per escludere il punto
-            } else
-                iy = int(((pData->m_pointArrayY[i] - Ax.YMin)*yfact) + Pf.bottom);
-
-            if(pData->GetProperties().Symbol == iplus) {
+            ix = int(point.x());
+            iy = int(point.y());
+
+            if(properties.Symbol == iplus) {
                 painter->drawLine(ix, iy-Size.height()/2, ix, iy+Size.height()/2+1);
                 painter->drawLine(ix-Size.width()/2, iy, ix+Size.width()/2+1, iy);
-            } else if(pData->GetProperties().Symbol == iper) {
+            } else if(properties.Symbol == iper) {
                 painter->drawLine(ix-Size.width()/2+1, iy+Size.height()/2-1, ix+Size.width()/2-1, iy-Size.height()/2);
                 painter->drawLine(ix+Size.width()/2-1, iy+Size.height()/2-1, ix-Size.width()/2+1, iy-Size.height()/2);
-            } else if(pData->GetProperties().Symbol == istar) {
+            } else if(properties.Symbol == istar) {
                 painter->drawLine(ix, iy-Size.height()/2, ix, iy+Size.height()/2+1);
                 painter->drawLine(ix-Size.width()/2, iy, ix+Size.width()/2+1, iy);
                 painter->drawLine(ix-Size.width()/2+1, iy+Size.height()/2-1, ix+Size.width()/2-1, iy-Size.height()/2);
                 painter->drawLine(ix+Size.width()/2-1, iy+Size.height()/2-1, ix-Size.width()/2+1, iy-Size.height()/2);
-            } else if(pData->GetProperties().Symbol == iuptriangle) {
+            } else if(properties.Symbol == iuptriangle) {
                 painter->drawLine(ix, iy-Size.height()/2, ix+Size.width()/2, iy+Size.height()/2);
                 painter->drawLine(ix+Size.width()/2, iy+Size.height()/2, ix-Size.width()/2, iy+Size.height()/2);
                 painter->drawLine(ix-Size.width()/2, iy+Size.height()/2, ix, iy-Size.height()/2);
-            } else if(pData->GetProperties().Symbol == idntriangle) {
+            } else if(properties.Symbol == idntriangle) {
                 painter->drawLine(ix, iy+Size.height()/2, ix+Size.width()/2, iy-Size.height()/2);
                 painter->drawLine(ix+Size.width()/2, iy-Size.height()/2, ix-Size.width()/2, iy-Size.height()/2);
                 painter->drawLine(ix-Size.width()/2, iy-Size.height()/2, ix, iy+Size.height()/2);
-            } else if(pData->GetProperties().Symbol == icircle) {
+            } else if(properties.Symbol == icircle) {
                 painter->drawEllipse(QRect(ix-Size.width()/2, iy-Size.height()/2, Size.width(), Size.height()));
             } else {
                 painter->drawLine(ix-Size.width()/2, iy, ix-Size.width()/2, iy-Size.height());
@@ -1009,12 +1111,22 @@ Plot2D::mouseDoubleClickEvent(QMouseEvent *event) {
 }
 
 
+// Called after each data update: the static layer is kept
+// (the limits are checked by DrawPlot())
 void
 Plot2D::UpdatePlot() {
+    update();
+}
+
+
+void
+Plot2D::onConfigChanged() {
     labelPen = pPropertiesDlg->labelColor;
     gridPen  = pPropertiesDlg->gridColor;
     framePen = pPropertiesDlg->frameColor;
     gridPen.setWidth(pPropertiesDlg->gridPenWidth);
+    setMaxPoints(pPropertiesDlg->maxDataPoints);
+    bStaticLayerValid = false;
     update();
 }
 
@@ -1024,6 +1136,7 @@ Plot2D::ClearPlot() {
     while(!dataSetList.isEmpty()) {
         delete dataSetList.takeFirst();
     }
+    dataSetById.clear();
     update();
 }
 
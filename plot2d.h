@@ -22,9 +22,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "datastream2d.h"
 #include "AxisLimits.h"
 #include "AxisFrame.h"
+#include "plottransform.h"
 
 #include <QWidget>
 #include <QPen>
+#include <QPixmap>
+#include <QHash>
 
 
 class Plot2D : public QWidget
@@ -53,6 +56,9 @@ signals:
 public slots:
     void UpdatePlot();
 
+protected slots:
+    void onConfigChanged();
+
 public:
     static const int iline       = 0;
     static const int ipoint      = 1;
@@ -63,17 +69,30 @@ public:
     static const int idntriangle = 6;
     static const int icircle     = 7;
 
+    // Line plots with more points than this, per pixel of the frame
+    // width, are decimated (only if the X values are sorted)
+    static const int LOD_POINTS_PER_PIXEL = 4;
+
 protected:
     void closeEvent(QCloseEvent *event);
     void keyPressEvent(QKeyEvent *e);
     void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void DrawStaticLayer(QFontMetrics fontMetrics);
     void DrawPlot(QPainter* painter, QFontMetrics fontMetrics);
     void DrawFrame(QPainter* painter, QFontMetrics fontMetrics);
     void XTicLin(QPainter* painter, QFontMetrics fontMetrics);
     void XTicLog(QPainter* painter, QFontMetrics fontMetrics);
     void YTicLin(QPainter* painter, QFontMetrics fontMetrics);
     void YTicLog(QPainter* painter, QFontMetrics fontMetrics);
+    DataStream2D* FindDataSet(int Id);
     void DrawData(QPainter* painter, QFontMetrics fontMetrics);
+    void TransformData(DataStream2D* pData);
+    QPointF ToScreen(double x, double y);
+    PlotTransform::Axis XAxis();
+    PlotTransform::Axis YAxis();
+    void DrawPolyline(QPainter* painter, const QPolygonF& points);
+    bool ClipSegment(QPointF& p0, QPointF& p1);
     void LinePlot(QPainter* painter, DataStream2D *pData);
     void PointPlot(QPainter* painter, DataStream2D* pData);
     void ScatterPlot(QPainter* painter, DataStream2D* pData);
@@ -86,7 +105,8 @@ protected:
 //  void wheelEvent(QWheelEvent* event);
 
 protected:
-    QList<DataStream2D*> dataSetList;
+    QList<DataStream2D*> dataSetList; // In drawing order
+    QHash<int, DataStream2D*> dataSetById;
     QPen labelPen;
     QPen gridPen;
     QPen framePen;
@@ -101,4 +121,15 @@ protected:
     double xfact, yfact;
     QPoint lastPos, zoomStart, zoomEnd;
     plotPropertiesDlg* pPropertiesDlg;
+
+private:
+    // Background, grid, tics and title: redrawn only when
+    // the size, the limits or the plot properties change
+    QPixmap staticLayer;
+    bool bStaticLayerValid;
+    AxisLimits staticLimits;
+    // Incremented each time the data to screen transform changes
+    int transformSerial;
+    PlotTransform::Axis transformX, transformY;
+    double xLogMin, yLogMin;
 };
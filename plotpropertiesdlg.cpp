@@ -71,7 +71,11 @@ plotPropertiesDlg::restoreSettings() {
     gridColor.setRgba(settings.value("GridColor",           QColor(Qt::blue).rgba()).toUInt());
     labelColor.setRgba(settings.value("LabelColor",         QColor(Qt::white).rgba()).toUInt());
     gridPenWidth      = settings.value("GridPenWidth",      1).toInt();
-    maxDataPoints     = settings.value("MaxDataPoints",     3000).toInt();
+    maxDataPoints     = settings.value("MaxDataPoints",     0).toInt();
+    // The 3000 saved as the default before 0 (keep all) was
+    // possible is dropped: it is kept if saved afterwards.
+    if((settings.value("MaxDataPointsVersion", 1).toInt() < 2) && (maxDataPoints == 3000))
+        maxDataPoints = 0;
     painterFontName   = settings.value("PainterFontName",   QString("Ubuntu")).toString();
     painterFontSize   = settings.value("PainterFontSize",   10).toInt();
     painterFontWeight = QFont::Weight(settings.value("PainterFontWeight", QFont::Bold).toInt());
@@ -94,6 +98,7 @@ plotPropertiesDlg::saveSettings() {
     settings.setValue("PainterBKColor", painterBkColor.rgba());
     settings.setValue("GridPenWidth", gridPenWidth);
     settings.setValue("MaxDataPoints", maxDataPoints);
+    settings.setValue("MaxDataPointsVersion", 2);
     settings.setValue("PainterFontName", painterFontName);
     settings.setValue("PainterFontSize", painterFontSize);
     settings.setValue("PainterFontWeight", painterFontWeight);
@@ -105,7 +110,7 @@ void
 plotPropertiesDlg::setToolTips() {
     QString sHeader = QString("Enter values in range [%1 : %2]");
     gridPenWidthEdit.setToolTip(sHeader.arg(1).arg(10));
-    maxDataPointsEdit.setToolTip(sHeader.arg(1).arg(10000));
+    maxDataPointsEdit.setToolTip(sHeader.arg(0).arg(10000) + QString(" (0 = keep all)"));
 }
 
 
@@ -244,7 +249,8 @@ plotPropertiesDlg::onChangeGridPenWidth(const QString sNewVal) {
 
 void
 plotPropertiesDlg::onChangeMaxDataPoints(const QString sNewVal) {
-    if((sNewVal.toInt() > 0) &&
+    bool bOk;
+    if(sNewVal.toInt(&bOk) >= 0 && bOk &&
        (sNewVal.toInt() < 10001))
     {
         maxDataPoints = sNewVal.toInt();
@@ -0,0 +1,130 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "plottransform.h"
+
+#include <math.h>
+#include <QtNumeric>
+
+#if defined(__SSE2__) && !defined(QT_COORD_TYPE)
+#include <emmintrin.h>
+#endif
+
+
+double
+PlotTransform::toScreen(double value, const Axis& axis) {
+    if(axis.bLog) {
+        if(!(value > 0.0))
+            return qQNaN();
+        value = log10(value);
+    }
+    return axis.offset + (value - axis.origin)*axis.scale;
+}
+
+
+void
+PlotTransform::toScreenScalar(const double* px, const double* py, int n,
+                              const Axis& xAxis, const Axis& yAxis, QPointF* pOut)
+{
+    for(int i=0; i<n; i++)
+        pOut[i] = QPointF(toScreen(px[i], xAxis), toScreen(py[i], yAxis));
+}
+
+
+#if defined(__SSE2__) && !defined(QT_COORD_TYPE)
+
+// log10 of two positive doubles: with x = m*2^e and m in [sqrt(1/2), sqrt(2))
+// ln(m) = 2*atanh(s) = 2*(s + s^3/3 + s^5/5 + ...) with s = (m-1)/(m+1).
+// Since |s| < 0.172 the truncated series is accurate to about 1e-12.
+// Non positive (or NaN) values give NaN. Denormals are not handled.
+static inline __m128d
+log10Sse2(__m128d x) {
+    const __m128i mantissaMask = _mm_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const __m128i exponentOne  = _mm_set1_epi64x(0x3FF0000000000000LL);
+    __m128i bits = _mm_castpd_si128(x);
+    // Biased exponents in the lower 32 bits of each lane
+    __m128i biased = _mm_srli_epi64(bits, 52);
+    biased = _mm_shuffle_epi32(biased, _MM_SHUFFLE(3, 1, 2, 0));
+    __m128d e = _mm_sub_pd(_mm_cvtepi32_pd(biased), _mm_set1_pd(1023.0));
+    // Mantissa in [1, 2) then moved to [sqrt(1/2), sqrt(2))
+    __m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, mantissaMask), exponentOne));
+    __m128d big = _mm_cmpgt_pd(m, _mm_set1_pd(M_SQRT2));
+    m = _mm_or_pd(_mm_and_pd(big, _mm_mul_pd(m, _mm_set1_pd(0.5))), _mm_andnot_pd(big, m));
+    e = _mm_add_pd(e, _mm_and_pd(big, _mm_set1_pd(1.0)));
+
+    __m128d one = _mm_set1_pd(1.0);
+    __m128d s  = _mm_div_pd(_mm_sub_pd(m, one), _mm_add_pd(m, one));
+    __m128d s2 = _mm_mul_pd(s, s);
+    __m128d p = _mm_set1_pd(1.0/13.0);
+    p = _mm_add_pd(_mm_mul_pd(p, s2), _mm_set1_pd(1.0/11.0));
+    p = _mm_add_pd(_mm_mul_pd(p, s2), _mm_set1_pd(1.0/9.0));
+    p = _mm_add_pd(_mm_mul_pd(p, s2), _mm_set1_pd(1.0/7.0));
+    p = _mm_add_pd(_mm_mul_pd(p, s2), _mm_set1_pd(1.0/5.0));
+    p = _mm_add_pd(_mm_mul_pd(p, s2), _mm_set1_pd(1.0/3.0));
+    p = _mm_add_pd(_mm_mul_pd(p, s2), one);
+    __m128d lnM = _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(2.0), s), p);
+    __m128d ln = _mm_add_pd(_mm_mul_pd(e, _mm_set1_pd(M_LN2)), lnM);
+    __m128d result = _mm_mul_pd(ln, _mm_set1_pd(1.0/M_LN10));
+
+    __m128d valid = _mm_cmpgt_pd(x, _mm_setzero_pd());
+    return _mm_or_pd(_mm_and_pd(valid, result),
+                     _mm_andnot_pd(valid, _mm_set1_pd(qQNaN())));
+}
+
+
+void
+PlotTransform::toScreen(const double* px, const double* py, int n,
+                        const Axis& xAxis, const Axis& yAxis, QPointF* pOut)
+{
+    Q_STATIC_ASSERT(sizeof(QPointF) == 2*sizeof(double));
+    const __m128d xOrigin = _mm_set1_pd(xAxis.origin);
+    const __m128d xScale  = _mm_set1_pd(xAxis.scale);
+    const __m128d xOffset = _mm_set1_pd(xAxis.offset);
+    const __m128d yOrigin = _mm_set1_pd(yAxis.origin);
+    const __m128d yScale  = _mm_set1_pd(yAxis.scale);
+    const __m128d yOffset = _mm_set1_pd(yAxis.offset);
+    double* pDst = reinterpret_cast<double*>(pOut);
+    int i = 0;
+    for(; i+2<=n; i+=2) {
+        __m128d x = _mm_loadu_pd(px+i);
+        __m128d y = _mm_loadu_pd(py+i);
+        if(xAxis.bLog) x = log10Sse2(x);
+        if(yAxis.bLog) y = log10Sse2(y);
+        x = _mm_add_pd(xOffset, _mm_mul_pd(_mm_sub_pd(x, xOrigin), xScale));
+        y = _mm_add_pd(yOffset, _mm_mul_pd(_mm_sub_pd(y, yOrigin), yScale));
+        // (x0, x1), (y0, y1) -> (x0, y0), (x1, y1)
+        _mm_storeu_pd(pDst+2*i,   _mm_unpacklo_pd(x, y));
+        _mm_storeu_pd(pDst+2*i+2, _mm_unpackhi_pd(x, y));
+    }
+    toScreenScalar(px+i, py+i, n-i, xAxis, yAxis, pOut+i);
+}
+
+#else
+
+void
+PlotTransform::toScreen(const double* px, const double* py, int n,
+                        const Axis& xAxis, const Axis& yAxis, QPointF* pOut)
+{
+    toScreenScalar(px, py, n, xAxis, yAxis, pOut);
+}
+
+#endif
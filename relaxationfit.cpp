@@ -0,0 +1,549 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "relaxationfit.h"
+
+#include <QThread>
+#include <QStringList>
+#include <algorithm>
+#include <random>
+#include <math.h>
+
+
+static const double E0                 = 8.854e-12;
+static const double LN10               = 2.302585092994046;
+static const int    TERM_PARAMETERS    = 4; // deltaE, log10(tau), alpha, beta
+static const double MIN_SHAPE          = 0.05;
+static const double RELATIVE_TOLERANCE = 1.0e-10;
+
+// Bound to references by QVector::append()
+const int RelaxationFit::DEBYE;
+const int RelaxationFit::COLE_COLE;
+const int RelaxationFit::HAVRILIAK_NEGAMI;
+
+
+RelaxationFit::RelaxationFit()
+    : bConductivity(false)
+    , nStarts(16)
+    , maxIterations(500)
+{
+    termTypes.append(HAVRILIAK_NEGAMI);
+}
+
+
+// The model is given as a list of terms, i.e. "HN+CC+DC": "D" (Debye),
+// "CC" (Cole-Cole) and "HN" (Havriliak-Negami) add a relaxation, "DC"
+// the conductivity.
+bool
+RelaxationFit::setModel(QString sModel, QString* pErrorString) {
+    QVector<int> newTypes;
+    bool bDc = false;
+    QStringList terms = sModel.toUpper().split('+', QString::SkipEmptyParts);
+    for(int i=0; i<terms.count(); i++) {
+        QString sTerm = terms.at(i).trimmed();
+        if(sTerm == "D" || sTerm == "DEBYE")
+            newTypes.append(DEBYE);
+        else if(sTerm == "CC")
+            newTypes.append(COLE_COLE);
+        else if(sTerm == "HN")
+            newTypes.append(HAVRILIAK_NEGAMI);
+        else if(sTerm == "DC")
+            bDc = true;
+        else {
+            if(pErrorString) *pErrorString = QString("Unknown model term: %1").arg(sTerm);
+            return false;
+        }
+    }
+    if(newTypes.isEmpty()) {
+        if(pErrorString) *pErrorString = QString("No relaxation in the model: %1").arg(sModel);
+        return false;
+    }
+    termTypes = newTypes;
+    bConductivity = bDc;
+    return true;
+}
+
+
+QString
+RelaxationFit::modelName() {
+    QStringList terms;
+    for(int i=0; i<termTypes.count(); i++) {
+        if(termTypes.at(i) == DEBYE)
+            terms.append("D");
+        else if(termTypes.at(i) == COLE_COLE)
+            terms.append("CC");
+        else
+            terms.append("HN");
+    }
+    if(bConductivity)
+        terms.append("DC");
+    return terms.join('+');
+}
+
+
+void
+RelaxationFit::setStarts(int nNewStarts) {
+    nStarts = qMax(1, nNewStarts);
+}
+
+
+// Parameters: eInf, then (deltaE, log10(tau), alpha, beta) for each
+// term and, with the conductivity, log10(sigma) and n.
+int
+RelaxationFit::parameterCount() {
+    return 1 + TERM_PARAMETERS*termTypes.count() + (bConductivity ? 2 : 0);
+}
+
+
+// The shape parameters fixed by the kind of the term are not fitted
+bool
+RelaxationFit::isFree(int iParameter) {
+    if(iParameter < 1 || iParameter > TERM_PARAMETERS*termTypes.count())
+        return true;
+    int iTerm  = (iParameter-1) / TERM_PARAMETERS;
+    int iShape = (iParameter-1) % TERM_PARAMETERS;
+    if(iShape == 2) // alpha
+        return termTypes.at(iTerm) != DEBYE;
+    if(iShape == 3) // beta
+        return termTypes.at(iTerm) == HAVRILIAK_NEGAMI;
+    return true;
+}
+
+
+// Keeps the parameters in their physical range
+void
+RelaxationFit::constrain(QVector<double>& p) {
+    double logTauMin = -log10(omegas.last()) - 3.0;
+    double logTauMax = -log10(omegas.first()) + 3.0;
+    p[0] = qMax(p[0], 0.0);
+    for(int i=0; i<termTypes.count(); i++) {
+        int iBase = 1 + TERM_PARAMETERS*i;
+        p[iBase]   = qMax(p[iBase], 0.0);
+        p[iBase+1] = qBound(logTauMin, p[iBase+1], logTauMax);
+        p[iBase+2] = (termTypes.at(i) == DEBYE) ? 1.0 : qBound(MIN_SHAPE, p[iBase+2], 1.0);
+        p[iBase+3] = (termTypes.at(i) == HAVRILIAK_NEGAMI) ? qBound(MIN_SHAPE, p[iBase+3], 1.0) : 1.0;
+    }
+    if(bConductivity) {
+        int iBase = 1 + TERM_PARAMETERS*termTypes.count();
+        p[iBase]   = qBound(-30.0, p[iBase], 5.0);
+        p[iBase+1] = qBound(MIN_SHAPE, p[iBase+1], 1.0);
+    }
+}
+
+
+// E* = E' - i*E" at omega. When pDerivatives is not null it receives
+// the derivatives with respect to each parameter:
+//     H = deltaE * D^-beta      D = 1 + w      w = (i*omega*tau)^alpha
+//     dH/d(deltaE)     = D^-beta
+//     dH/d(log10(tau)) = -beta*deltaE*D^(-beta-1) * alpha*w * ln(10)
+//     dH/d(alpha)      = -beta*deltaE*D^(-beta-1) * w*ln(i*omega*tau)
+//     dH/d(beta)       = -H*ln(D)
+std::complex<double>
+RelaxationFit::model(const QVector<double>& p, double omega, std::complex<double>* pDerivatives) {
+    const std::complex<double> I(0.0, 1.0);
+    std::complex<double> value(p[0], 0.0);
+    if(pDerivatives)
+        pDerivatives[0] = 1.0;
+    for(int i=0; i<termTypes.count(); i++) {
+        int iBase = 1 + TERM_PARAMETERS*i;
+        double deltaE = p[iBase];
+        double tau    = pow(10.0, p[iBase+1]);
+        double alpha  = p[iBase+2];
+        double beta   = p[iBase+3];
+        std::complex<double> logZ(log(omega*tau), 0.5*M_PI);
+        std::complex<double> w = exp(alpha*logZ);
+        std::complex<double> d = 1.0 + w;
+        std::complex<double> dPow = pow(d, -beta);
+        std::complex<double> h = deltaE*dPow;
+        value += h;
+        if(pDerivatives) {
+            std::complex<double> common = -beta*deltaE*dPow/d;
+            pDerivatives[iBase]   = dPow;
+            pDerivatives[iBase+1] = common*alpha*w*LN10;
+            pDerivatives[iBase+2] = common*w*logZ;
+            pDerivatives[iBase+3] = -h*log(d);
+        }
+    }
+    if(bConductivity) {
+        int iBase = 1 + TERM_PARAMETERS*termTypes.count();
+        double eDc = pow(10.0, p[iBase]) / (E0*pow(omega, p[iBase+1]));
+        value -= I*eDc;
+        if(pDerivatives) {
+            pDerivatives[iBase]   = -I*eDc*LN10;
+            pDerivatives[iBase+1] =  I*eDc*log(omega);
+        }
+    }
+    return value;
+}
+
+
+// Start 0 puts the relaxations at the peaks of E", the others
+// are random (but reproducible) guesses over the measured range.
+QVector<double>
+RelaxationFit::initialGuess(int iStart) {
+    int nPoints = omegas.count();
+    int nTerms  = termTypes.count();
+    double e1Min = *std::min_element(e1Data.constBegin(), e1Data.constEnd());
+    double e1Max = *std::max_element(e1Data.constBegin(), e1Data.constEnd());
+    double deltaTotal = qMax(e1Max-e1Min, 1.0e-3*qAbs(e1Max));
+    double logTauMin = -log10(omegas.last()) - 1.0;
+    double logTauMax = -log10(omegas.first()) + 1.0;
+
+    QVector<double> p(parameterCount(), 1.0);
+    p[0] = e1Min;
+    std::mt19937 generator(static_cast<unsigned>(iStart));
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    if(iStart == 0) {
+        QVector<int> peaks;
+        for(int i=1; i<nPoints-1; i++) {
+            if(e2Data.at(i) > e2Data.at(i-1) && e2Data.at(i) >= e2Data.at(i+1))
+                peaks.append(i);
+        }
+        std::sort(peaks.begin(), peaks.end(), [this](int a, int b) {
+            return e2Data.at(a) > e2Data.at(b);
+        });
+        for(int i=0; i<nTerms; i++) {
+            int iBase = 1 + TERM_PARAMETERS*i;
+            p[iBase] = deltaTotal/nTerms;
+            if(i < peaks.count())
+                p[iBase+1] = -log10(omegas.at(peaks.at(i)));
+            else
+                p[iBase+1] = logTauMin + (i+0.5)*(logTauMax-logTauMin)/nTerms;
+            p[iBase+2] = 0.8;
+            p[iBase+3] = 0.8;
+        }
+    }
+    else {
+        double sum = 0.0;
+        for(int i=0; i<nTerms; i++) {
+            int iBase = 1 + TERM_PARAMETERS*i;
+            p[iBase]   = 0.1 + uniform(generator);
+            sum       += p[iBase];
+            p[iBase+1] = logTauMin + uniform(generator)*(logTauMax-logTauMin);
+            p[iBase+2] = 0.3 + 0.7*uniform(generator);
+            p[iBase+3] = 0.3 + 0.7*uniform(generator);
+        }
+        for(int i=0; i<nTerms; i++)
+            p[1 + TERM_PARAMETERS*i] *= deltaTotal/sum;
+    }
+    if(bConductivity) {
+        // As if the lowest frequency loss were all due to the conductivity
+        int iBase = 1 + TERM_PARAMETERS*nTerms;
+        double sigma = 0.5*qMax(e2Data.first(), 1.0e-6)*E0*omegas.first();
+        p[iBase]   = log10(sigma);
+        p[iBase+1] = 1.0;
+        if(iStart > 0)
+            p[iBase] += 2.0*uniform(generator) - 1.0;
+    }
+    constrain(p);
+    return p;
+}
+
+
+// Both E' and E" are weighted by 1/|E*| so that every
+// frequency counts the same over many decades of E".
+double
+RelaxationFit::chiSquare(const QVector<double>& p) {
+    double sum = 0.0;
+    for(int i=0; i<omegas.count(); i++) {
+        std::complex<double> value = model(p, omegas.at(i), nullptr);
+        double r1 = (value.real() - e1Data.at(i))*weights.at(i);
+        double r2 = (-value.imag() - e2Data.at(i))*weights.at(i);
+        sum += r1*r1 + r2*r2;
+    }
+    return sum;
+}
+
+
+// Refines p in place. Returns the number of iterations.
+int
+RelaxationFit::levenbergMarquardt(QVector<double>& p, double* pChi2, bool* pbConverged) {
+    int nParameters = parameterCount();
+    QVector<int> freeParameters;
+    for(int i=0; i<nParameters; i++) {
+        if(isFree(i))
+            freeParameters.append(i);
+    }
+    int nFree = freeParameters.count();
+    QVector<std::complex<double>> derivatives(nParameters);
+    QVector<double> jtj(nFree*nFree);
+    QVector<double> jtr(nFree);
+    QVector<double> row1(nFree), row2(nFree);
+    QVector<double> step;
+    double chi2   = chiSquare(p);
+    double lambda = 1.0e-3;
+    *pbConverged  = false;
+    int iteration;
+    for(iteration=0; iteration<maxIterations; iteration++) {
+        jtj.fill(0.0);
+        jtr.fill(0.0);
+        for(int i=0; i<omegas.count(); i++) {
+            std::complex<double> value = model(p, omegas.at(i), derivatives.data());
+            double w  = weights.at(i);
+            double r1 = (value.real() - e1Data.at(i))*w;
+            double r2 = (-value.imag() - e2Data.at(i))*w;
+            for(int j=0; j<nFree; j++) {
+                row1[j] =  derivatives.at(freeParameters.at(j)).real()*w;
+                row2[j] = -derivatives.at(freeParameters.at(j)).imag()*w;
+            }
+            for(int j=0; j<nFree; j++) {
+                jtr[j] += row1.at(j)*r1 + row2.at(j)*r2;
+                for(int k=0; k<=j; k++)
+                    jtj[j*nFree+k] += row1.at(j)*row1.at(k) + row2.at(j)*row2.at(k);
+            }
+        }
+        for(int j=0; j<nFree; j++) {
+            for(int k=0; k<j; k++)
+                jtj[k*nFree+j] = jtj.at(j*nFree+k);
+        }
+        // Increase lambda until the step reduces chi square
+        bool bImproved = false;
+        while(lambda < 1.0e12) {
+            QVector<double> a = jtj;
+            QVector<double> b(nFree);
+            for(int j=0; j<nFree; j++) {
+                a[j*nFree+j] += lambda*qMax(jtj.at(j*nFree+j), 1.0e-30);
+                b[j] = -jtr.at(j);
+            }
+            if(solve(a, b, &step)) {
+                QVector<double> trial = p;
+                for(int j=0; j<nFree; j++)
+                    trial[freeParameters.at(j)] += step.at(j);
+                constrain(trial);
+                double trialChi2 = chiSquare(trial);
+                if(trialChi2 < chi2) {
+                    bImproved = true;
+                    bool bSmall = (chi2-trialChi2) <= RELATIVE_TOLERANCE*chi2;
+                    p      = trial;
+                    chi2   = trialChi2;
+                    lambda = qMax(lambda*0.1, 1.0e-12);
+                    if(bSmall)
+                        *pbConverged = true;
+                    break;
+                }
+            }
+            lambda *= 10.0;
+        }
+        // No step can improve the fit: we are at a minimum
+        if(!bImproved)
+            *pbConverged = true;
+        if(*pbConverged)
+            break;
+    }
+    *pChi2 = chi2;
+    return iteration + 1;
+}
+
+
+// Gaussian elimination with partial pivoting of the n x n system a*x = b
+bool
+RelaxationFit::solve(QVector<double> a, QVector<double> b, QVector<double>* pX) {
+    int n = b.count();
+    for(int col=0; col<n; col++) {
+        int iPivot = col;
+        for(int row=col+1; row<n; row++) {
+            if(qAbs(a.at(row*n+col)) > qAbs(a.at(iPivot*n+col)))
+                iPivot = row;
+        }
+        if(a.at(iPivot*n+col) == 0.0 || !std::isfinite(a.at(iPivot*n+col)))
+            return false;
+        if(iPivot != col) {
+            for(int k=0; k<n; k++)
+                std::swap(a[col*n+k], a[iPivot*n+k]);
+            std::swap(b[col], b[iPivot]);
+        }
+        for(int row=col+1; row<n; row++) {
+            double factor = a.at(row*n+col)/a.at(col*n+col);
+            for(int k=col; k<n; k++)
+                a[row*n+k] -= factor*a.at(col*n+k);
+            b[row] -= factor*b.at(col);
+        }
+    }
+    pX->resize(n);
+    for(int row=n-1; row>=0; row--) {
+        double sum = b.at(row);
+        for(int k=row+1; k<n; k++)
+            sum -= a.at(row*n+k)*pX->at(k);
+        (*pX)[row] = sum/a.at(row*n+row);
+        if(!std::isfinite(pX->at(row)))
+            return false;
+    }
+    return true;
+}
+
+
+FitResult
+RelaxationFit::toResult(const QVector<double>& p) {
+    FitResult result;
+    result.eInf = p[0];
+    for(int i=0; i<termTypes.count(); i++) {
+        int iBase = 1 + TERM_PARAMETERS*i;
+        RelaxationTerm term;
+        term.type   = termTypes.at(i);
+        term.deltaE = p[iBase];
+        term.tau    = pow(10.0, p[iBase+1]);
+        term.alpha  = p[iBase+2];
+        term.beta   = p[iBase+3];
+        result.terms.append(term);
+    }
+    // Slowest relaxation first
+    std::sort(result.terms.begin(), result.terms.end(),
+              [](const RelaxationTerm& a, const RelaxationTerm& b) {
+        return a.tau > b.tau;
+    });
+    result.bConductivity = bConductivity;
+    result.sigma = 0.0;
+    result.n     = 1.0;
+    if(bConductivity) {
+        int iBase = 1 + TERM_PARAMETERS*termTypes.count();
+        result.sigma = pow(10.0, p[iBase]);
+        result.n     = p[iBase+1];
+    }
+    result.chiSquare  = 0.0;
+    result.iterations = 0;
+    result.nStarts    = nStarts;
+    result.bConverged = false;
+    return result;
+}
+
+
+// The points with a non positive frequency are ignored. The initial
+// guesses are shared among the threads: each one keeps its best fit.
+FitResult
+RelaxationFit::fit(const QVector<double>& frequencies,
+                   const QVector<double>& e1,
+                   const QVector<double>& e2)
+{
+    QVector<int> order;
+    for(int i=0; i<frequencies.count() && i<e1.count() && i<e2.count(); i++) {
+        if(frequencies.at(i) > 0.0)
+            order.append(i);
+    }
+    std::sort(order.begin(), order.end(), [&frequencies](int a, int b) {
+        return frequencies.at(a) < frequencies.at(b);
+    });
+    omegas.clear();
+    e1Data.clear();
+    e2Data.clear();
+    weights.clear();
+    for(int i=0; i<order.count(); i++) {
+        int j = order.at(i);
+        omegas.append(2.0*M_PI*frequencies.at(j));
+        e1Data.append(e1.at(j));
+        e2Data.append(e2.at(j));
+        double modulus = sqrt(e1.at(j)*e1.at(j) + e2.at(j)*e2.at(j));
+        weights.append(modulus > 0.0 ? 1.0/modulus : 1.0);
+    }
+    int nFree = 0;
+    for(int i=0; i<parameterCount(); i++) {
+        if(isFree(i))
+            nFree++;
+    }
+    int nDegrees = 2*omegas.count() - nFree;
+    if(nDegrees <= 0) {
+        FitResult result = toResult(QVector<double>(parameterCount(), 0.0));
+        result.nStarts = 0;
+        return result;
+    }
+
+    QVector<QVector<double>> bestParameters(nStarts);
+    QVector<double> bestChi2(nStarts);
+    QVector<int>    bestIterations(nStarts);
+    QVector<bool>   bestConverged(nStarts);
+    int nThreads = qBound(1, QThread::idealThreadCount(), nStarts);
+    QVector<QThread*> threads;
+    for(int t=0; t<nThreads; t++) {
+        QThread* pThread = QThread::create([this, t, nThreads, &bestParameters,
+                                            &bestChi2, &bestIterations, &bestConverged]() {
+            for(int iStart=t; iStart<nStarts; iStart+=nThreads) {
+                QVector<double> p = initialGuess(iStart);
+                bool bConverged;
+                double chi2;
+                bestIterations[iStart]  = levenbergMarquardt(p, &chi2, &bConverged);
+                bestParameters[iStart]  = p;
+                bestChi2[iStart]        = std::isfinite(chi2) ? chi2 : HUGE_VAL;
+                bestConverged[iStart]   = bConverged;
+            }
+        });
+        pThread->start();
+        threads.append(pThread);
+    }
+    for(int t=0; t<nThreads; t++) {
+        threads.at(t)->wait();
+        delete threads.at(t);
+    }
+    int iBest = 0;
+    for(int i=1; i<nStarts; i++) {
+        if(bestChi2.at(i) < bestChi2.at(iBest))
+            iBest = i;
+    }
+    FitResult result  = toResult(bestParameters.at(iBest));
+    result.chiSquare  = bestChi2.at(iBest)/nDegrees;
+    result.iterations = bestIterations.at(iBest);
+    result.bConverged = bestConverged.at(iBest);
+    return result;
+}
+
+
+std::complex<double>
+RelaxationFit::evaluate(const FitResult& result, double f) {
+    const std::complex<double> I(0.0, 1.0);
+    double omega = 2.0*M_PI*f;
+    std::complex<double> value(result.eInf, 0.0);
+    for(int i=0; i<result.terms.count(); i++) {
+        const RelaxationTerm& term = result.terms.at(i);
+        std::complex<double> w = pow(I*omega*term.tau, term.alpha);
+        value += term.deltaE*pow(1.0+w, -term.beta);
+    }
+    if(result.bConductivity)
+        value -= I*result.sigma/(E0*pow(omega, result.n));
+    return value;
+}
+
+
+QString
+RelaxationFit::summary(const FitResult& result) {
+    static const char* names[] = {"D", "CC", "HN"};
+    QString sSummary = QString("Einf=%1").arg(result.eInf, 0, 'g', 5);
+    for(int i=0; i<result.terms.count(); i++) {
+        const RelaxationTerm& term = result.terms.at(i);
+        sSummary += QString("\n%1%2: dE=%3 tau=%4s")
+                    .arg(names[term.type])
+                    .arg(i+1)
+                    .arg(term.deltaE, 0, 'g', 5)
+                    .arg(term.tau, 0, 'g', 5);
+        if(term.type != DEBYE)
+            sSummary += QString(" alpha=%1").arg(term.alpha, 0, 'f', 3);
+        if(term.type == HAVRILIAK_NEGAMI)
+            sSummary += QString(" beta=%1").arg(term.beta, 0, 'f', 3);
+    }
+    if(result.bConductivity)
+        sSummary += QString("\nDC: sigma=%1 n=%2")
+                    .arg(result.sigma, 0, 'g', 5)
+                    .arg(result.n, 0, 'f', 3);
+    sSummary += QString("\nChi2=%1 after %2 iterations (%3 starts)%4")
+                .arg(result.chiSquare, 0, 'g', 4)
+                .arg(result.iterations)
+                .arg(result.nStarts)
+                .arg(result.bConverged ? "" : " NOT CONVERGED");
+    return sSummary;
+}
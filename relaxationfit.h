@@ -0,0 +1,105 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QVector>
+#include <QString>
+#include <complex>
+
+
+// A relaxation of the complex permittivity:
+//     deltaE / (1 + (i*omega*tau)^alpha)^beta
+// Debye has alpha=beta=1, Cole-Cole beta=1, Havriliak-Negami both free.
+struct RelaxationTerm {
+    int    type;    // RelaxationFit::DEBYE, COLE_COLE or HAVRILIAK_NEGAMI
+    double deltaE;  // Relaxation strength
+    double tau;     // Relaxation time (s)
+    double alpha;   // Symmetric broadening (0,1]
+    double beta;    // Asymmetric broadening (0,1]
+};
+
+
+// E*(omega) = eInf + sum of the terms - i*sigma/(e0*omega^n)
+struct FitResult {
+    double                  eInf;
+    QVector<RelaxationTerm> terms;
+    bool                    bConductivity;
+    double                  sigma;       // S/m when n = 1
+    double                  n;           // Conductivity exponent (0,1]
+    double                  chiSquare;   // Weighted, per degree of freedom
+    int                     iterations;
+    int                     nStarts;     // Initial guesses tried
+    bool                    bConverged;
+};
+
+
+// Nonlinear least squares fit of a model made of Debye, Cole-Cole and
+// Havriliak-Negami terms, plus an optional DC conductivity, to E' and E".
+// The Levenberg-Marquardt iterations use the analytic derivatives of the
+// model. To avoid the local minima the fit is repeated from several
+// initial guesses, spread over the threads available, and the best
+// result is kept.
+class RelaxationFit
+{
+public:
+    RelaxationFit();
+
+public:
+    bool      setModel(QString sModel, QString* pErrorString);
+    QString   modelName();
+    void      setStarts(int nStarts);
+    FitResult fit(const QVector<double>& frequencies,
+                  const QVector<double>& e1,
+                  const QVector<double>& e2);
+
+    static std::complex<double> evaluate(const FitResult& result, double f);
+    static QString              summary(const FitResult& result);
+
+public:
+    static const int DEBYE            = 0;
+    static const int COLE_COLE        = 1;
+    static const int HAVRILIAK_NEGAMI = 2;
+
+protected:
+    int             parameterCount();
+    bool            isFree(int iParameter);
+    void            constrain(QVector<double>& p);
+    std::complex<double> model(const QVector<double>& p, double omega,
+                               std::complex<double>* pDerivatives);
+    QVector<double> initialGuess(int iStart);
+    double          chiSquare(const QVector<double>& p);
+    int             levenbergMarquardt(QVector<double>& p, double* pChi2, bool* pbConverged);
+    FitResult       toResult(const QVector<double>& p);
+    static bool     solve(QVector<double> a, QVector<double> b, QVector<double>* pX);
+
+private:
+    QVector<int>    termTypes;
+    bool            bConductivity;
+    int             nStarts;
+    int             maxIterations;
+    // The data being fitted
+    QVector<double> omegas;
+    QVector<double> e1Data;
+    QVector<double> e2Data;
+    QVector<double> weights;
+};
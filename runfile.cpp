@@ -0,0 +1,210 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runfile.h"
+#include "derivedquantities.h"
+
+#include <string.h>
+
+Q_STATIC_ASSERT(sizeof(RunFileHeader) == 88);
+Q_STATIC_ASSERT(sizeof(RunRecord) == 64);
+
+
+RunFile::RunFile()
+    : pMap(nullptr)
+    , pHeader(nullptr)
+    , pRecords(nullptr)
+    , recordSize(sizeof(RunRecord))
+    , nRecords(0)
+{
+}
+
+
+RunFile::~RunFile() {
+    close();
+}
+
+
+// Returns the header, to be written at the beginning of the file,
+// with the format fields (magic, version, sizes...) filled in.
+QByteArray
+RunFile::makeHeader(RunFileHeader header, QString sSampleInfo) {
+    QByteArray info = sSampleInfo.toUtf8();
+    memcpy(header.magic, "DIELRUN", sizeof(header.magic));
+    header.byteOrder      = BYTE_ORDER_MARK;
+    header.version        = VERSION;
+    header.sampleInfoSize = quint32(info.size());
+    header.headerSize     = quint32(sizeof(RunFileHeader) + info.size() + 7) & ~7u;
+    header.recordSize     = sizeof(RunRecord);
+    QByteArray data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(info);
+    data.append(int(header.headerSize) - data.size(), '\0');
+    return data;
+}
+
+
+QByteArray
+RunFile::makeRecord(const RunRecord& record) {
+    return QByteArray(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+
+// Maps the file in memory: the records are then accessed in place,
+// without reading or parsing them.
+bool
+RunFile::open(QString sFileName, QString* pErrorString) {
+    close();
+    QString sError;
+    file.setFileName(sFileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        if(pErrorString) *pErrorString = file.errorString();
+        return false;
+    }
+    qint64 size = file.size();
+    if(size >= qint64(sizeof(RunFileHeader))) {
+        pMap = file.map(0, size);
+        if(!pMap)
+            sError = file.errorString();
+    } else {
+        sError = QString("Not a run file");
+    }
+    if(pMap) {
+        pHeader = reinterpret_cast<const RunFileHeader*>(pMap);
+        if(memcmp(pHeader->magic, "DIELRUN", sizeof(pHeader->magic)) != 0)
+            sError = QString("Not a run file");
+        else if(pHeader->byteOrder != BYTE_ORDER_MARK)
+            sError = QString("Run file written with a different byte order");
+        else if((pHeader->version < 1) ||
+                (pHeader->headerSize < sizeof(RunFileHeader) + pHeader->sampleInfoSize) ||
+                (pHeader->headerSize % 8 != 0) ||
+                (qint64(pHeader->headerSize) > size) ||
+                (pHeader->recordSize < sizeof(RunRecord)) ||
+                (pHeader->recordSize % 8 != 0))
+            sError = QString("Corrupted run file header");
+    }
+    if(!sError.isEmpty()) {
+        close();
+        if(pErrorString) *pErrorString = sError;
+        return false;
+    }
+    recordSize = pHeader->recordSize;
+    pRecords   = pMap + pHeader->headerSize;
+    // A partially written last record is ignored
+    nRecords   = int((size - pHeader->headerSize) / recordSize);
+    return true;
+}
+
+
+void
+RunFile::close() {
+    if(pMap)
+        file.unmap(pMap);
+    if(file.isOpen())
+        file.close();
+    pMap     = nullptr;
+    pHeader  = nullptr;
+    pRecords = nullptr;
+    nRecords = 0;
+}
+
+
+bool
+RunFile::isOpen() const {
+    return pHeader != nullptr;
+}
+
+
+int
+RunFile::count() const {
+    return nRecords;
+}
+
+
+const RunFileHeader&
+RunFile::header() const {
+    return *pHeader;
+}
+
+
+QString
+RunFile::sampleInfo() const {
+    return QString::fromUtf8(reinterpret_cast<const char*>(pHeader) + sizeof(RunFileHeader),
+                             int(pHeader->sampleInfoSize));
+}
+
+
+// Writes the valid points in the same text format of the
+// output file (suitable for GnuPlot).
+bool
+RunFile::exportText(QString sFileName, const DerivedQuantities& derived,
+                    QString* pErrorString) const
+{
+    if(!isOpen()) {
+        if(pErrorString) *pErrorString = QString("No run file open");
+        return false;
+    }
+    QFile textFile(sFileName);
+    if(!textFile.open(QIODevice::Text|QIODevice::WriteOnly)) {
+        if(pErrorString) *pErrorString = textFile.errorString();
+        return false;
+    }
+    textFile.write(QString("%1 %2 %3 %4 %5 %6%7\n")
+                   .arg("#Frequency[Hz]", 12)
+                   .arg("E1r", 12)
+                   .arg("E2r", 12)
+                   .arg("TanD", 12)
+                   .arg("Cp", 12)
+                   .arg("Settle[s]", 12)
+                   .arg(derived.header())
+                   .toLocal8Bit());
+    textFile.write(QString("#Area = %1mm^2 Thickness=%2mm C0=%3 F\n")
+                   .arg(pHeader->area, 12)
+                   .arg(pHeader->thickness, 12)
+                   .arg(pHeader->c0, 12)
+                   .toLocal8Bit());
+    QStringList HeaderLines = sampleInfo().split("\n");
+    for(int i=0; i<HeaderLines.count(); i++)
+        textFile.write("# " + HeaderLines.at(i).toLocal8Bit() + "\n");
+    double derivedValues[DerivedQuantities::N_QUANTITIES];
+    for(int i=0; i<nRecords; i++) {
+        const RunRecord& point = record(i);
+        if(point.status != 0)
+            continue;
+        QString sLine = QString("%1 %2 %3 %4 %5 %6")
+                        .arg(point.frequency, 12, 'g', 6, ' ')
+                        .arg(point.e1, 12, 'g', 6, ' ')
+                        .arg(point.e2, 12, 'g', 6, ' ')
+                        .arg(point.d, 12, 'g', 6, ' ')
+                        .arg(point.cp, 12, 'g', 6, ' ')
+                        .arg(point.settle, 12, 'g', 6, ' ');
+        int nDerived = derived.compute(point, pHeader->c0, derivedValues);
+        for(int j=0; j<nDerived; j++)
+            sLine += QString(" %1").arg(derivedValues[j], 12, 'g', 6, ' ');
+        textFile.write(sLine.toLocal8Bit() + "\n");
+    }
+    textFile.close();
+    if(textFile.error() != QFileDevice::NoError) {
+        if(pErrorString) *pErrorString = textFile.errorString();
+        return false;
+    }
+    return true;
+}
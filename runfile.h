@@ -0,0 +1,112 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QStringList>
+#include <QMetaType>
+
+
+class DerivedQuantities;
+
+// Binary run file (in the byte order of the writer, see byteOrder):
+//     RunFileHeader
+//     sampleInfoSize bytes of UTF-8 sample information
+//     padding up to headerSize (a multiple of 8)
+//     RunRecord, every recordSize bytes, up to the end of the file
+// The number of records is given by the file size, so a file whose
+// writing has been interrupted is still readable. Readers must use
+// headerSize and recordSize: newer versions may only append fields.
+struct RunFileHeader {
+    char    magic[8];        // "DIELRUN" (null terminated)
+    quint32 byteOrder;       // 0x01020304 as written by the writer
+    quint32 version;
+    quint32 headerSize;      // Offset of the first record
+    quint32 recordSize;
+    double  area;            // mm^2
+    double  thickness;       // mm
+    double  c0;              // F
+    double  testVoltage;     // V
+    double  settlingPeriods; // Of the test signal before each point
+    qint64  startTime;       // ms since the epoch (UTC)
+    qint32  mode;            // Measurement function (i.e. Hp4284a::CPD)
+    qint32  flags;           // See the RunFile flags
+    qint32  frequencyPlan;   // FrequencyPlan::LOG_GRID, FILE_LIST or ADAPTIVE
+    quint32 sampleInfoSize;
+};
+
+
+struct RunRecord {
+    double frequency;  // Hz
+    double cp;         // F
+    double d;          // tan(delta)
+    double e1;         // E'
+    double e2;         // E"
+    double settle;     // Settling delay (s)
+    qint64 timestamp;  // ms since the epoch (UTC)
+    qint32 status;     // 0 means a normal measurement
+    qint32 reserved;
+};
+Q_DECLARE_METATYPE(RunRecord)
+
+
+class RunFile
+{
+public:
+    RunFile();
+    ~RunFile();
+
+public:
+    static QByteArray makeHeader(RunFileHeader header, QString sSampleInfo);
+    static QByteArray makeRecord(const RunRecord& record);
+
+    bool      open(QString sFileName, QString* pErrorString);
+    void      close();
+    bool      isOpen() const;
+    int       count() const;
+    QString   sampleInfo() const;
+    bool      exportText(QString sFileName, const DerivedQuantities& derived,
+                         QString* pErrorString) const;
+    const RunFileHeader& header() const;
+    inline const RunRecord& record(int i) const {
+        return *reinterpret_cast<const RunRecord*>(pRecords + qint64(i)*recordSize);
+    }
+
+public:
+    static const quint32 VERSION          = 1;
+    static const quint32 BYTE_ORDER_MARK  = 0x01020304;
+    static const qint32  OPEN_CORRECTION  = 0x01;
+    static const qint32  SHORT_CORRECTION = 0x02;
+    static const qint32  BINARY_TRANSFER  = 0x04;
+
+private:
+    QFile                file;
+    uchar*               pMap;
+    const RunFileHeader* pHeader;
+    const uchar*         pRecords;
+    qint64               recordSize;
+    int                  nRecords;
+};
@@ -0,0 +1,134 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "sessionmanager.h"
+#include "instrumentdiscovery.h"
+
+#include <QFileInfo>
+
+
+// The journal of each Sweep is kept in the settings
+// group sPrefix/<meter name>.
+SessionManager::SessionManager(QString sPrefix, QObject *parent)
+    : QObject(parent)
+    , sJournalPrefix(sPrefix)
+{
+}
+
+
+// The Sweeps must be deleted before their meters
+SessionManager::~SessionManager() {
+    for(int i=0; i<sessions.count(); i++) {
+        delete sessions.at(i).pSweep;
+        delete sessions.at(i).pMeter;
+    }
+}
+
+
+// The GPIB boards with a device file (/dev/gpib0 ... /dev/gpib15)
+QVector<int>
+SessionManager::availableBoards() {
+    QVector<int> boards;
+    for(int board=0; board<MAX_BOARDS; board++) {
+        if(QFileInfo::exists(QString("/dev/gpib%1").arg(board)))
+            boards.append(board);
+    }
+    return boards;
+}
+
+
+// Adds all the HP4284A found on the given boards (see InstrumentDiscovery).
+// Returns the number of meters available.
+int
+SessionManager::discover(QVector<int> boards, bool bFullScan, QString* pErrorString) {
+    InstrumentDiscovery discovery;
+    connect(&discovery, SIGNAL(instrumentFound(int,int,QString)),
+            this, SLOT(onInstrumentFound(int,int,QString)));
+    discovery.discover(boards, bFullScan, pErrorString);
+    if((sessions.count() == 0) && pErrorString)
+        *pErrorString += QString("HP4284A LCR Meter Not Connected");
+    return sessions.count();
+}
+
+
+void
+SessionManager::onInstrumentFound(int board, int address, QString sIdn) {
+    if(sIdn.contains("4284A", Qt::CaseInsensitive))
+        addMeter(board, address);
+}
+
+
+// Returns the index of the meter (the existing one if already added)
+int
+SessionManager::addMeter(int board, int address) {
+    for(int i=0; i<sessions.count(); i++) {
+        if((sessions.at(i).board == board) && (sessions.at(i).address == address))
+            return i;
+    }
+    Session session;
+    session.board   = board;
+    session.address = address;
+    session.pMeter  = new Hp4284a(board, address);
+    session.pSweep  = new Sweep(session.pMeter);
+    sessions.append(session);
+    int i = sessions.count()-1;
+    session.pSweep->setJournalKey(sJournalPrefix + "/" + name(i).replace('@', '_'));
+    emit meterAdded(i);
+    return i;
+}
+
+
+int
+SessionManager::count() const {
+    return sessions.count();
+}
+
+
+Hp4284a*
+SessionManager::meter(int i) const {
+    return sessions.at(i).pMeter;
+}
+
+
+Sweep*
+SessionManager::sweep(int i) const {
+    return sessions.at(i).pSweep;
+}
+
+
+// i.e. "GPIB0@17"
+QString
+SessionManager::name(int i) const {
+    return QString("GPIB%1@%2").arg(sessions.at(i).board).arg(sessions.at(i).address);
+}
+
+
+// The index of the meter named sName or -1 if not found
+int
+SessionManager::indexOf(QString sName) const {
+    for(int i=0; i<sessions.count(); i++) {
+        if(name(i) == sName)
+            return i;
+    }
+    return -1;
+}
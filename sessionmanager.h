@@ -0,0 +1,76 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QString>
+
+#include "hp4284a.h"
+#include "sweep.h"
+
+
+// The HP4284A meters connected to one or more GPIB boards, each one
+// with its own Sweep. Every meter has its own I/O thread (see GpibDevice):
+// while a meter is integrating, its thread waits for the Service Request
+// without holding the bus, so the other meters can be served and the
+// sweeps run concurrently.
+class SessionManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionManager(QString sPrefix, QObject *parent = nullptr);
+    virtual ~SessionManager();
+
+public:
+    static QVector<int> availableBoards();
+    int      discover(QVector<int> boards, bool bFullScan, QString* pErrorString);
+    int      addMeter(int board, int address);
+    int      count() const;
+    Hp4284a* meter(int i) const;
+    Sweep*   sweep(int i) const;
+    QString  name(int i) const;
+    int      indexOf(QString sName) const;
+
+public:
+    static const int MAX_BOARDS = 16; // As linux-gpib
+
+signals:
+    void meterAdded(int i);
+
+public slots:
+    void onInstrumentFound(int board, int address, QString sIdn);
+
+protected:
+    struct Session {
+        int      board;
+        int      address;
+        Hp4284a* pMeter;
+        Sweep*   pSweep;
+    };
+
+private:
+    QVector<Session> sessions;
+    QString          sJournalPrefix;
+};
@@ -0,0 +1,300 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "spectrumanalyzer.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QStringList>
+#include <QElapsedTimer>
+
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent)
+    : QObject(parent)
+    , pThread(nullptr)
+    , bWorking(false)
+{
+}
+
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    if(pThread) {
+        pThread->wait();
+        delete pThread;
+    }
+}
+
+
+// Must not be called while an analysis is running
+bool
+SpectrumAnalyzer::setModel(QString sModel, QString* pErrorString) {
+    return relaxationFit.setModel(sModel, pErrorString);
+}
+
+
+void
+SpectrumAnalyzer::setStarts(int nStarts) {
+    relaxationFit.setStarts(nStarts);
+}
+
+
+// Maximum residual, relative to |E*|, of a consistent point
+void
+SpectrumAnalyzer::setKkThreshold(double threshold) {
+    kramersKronig.setThreshold(threshold);
+}
+
+
+bool
+SpectrumAnalyzer::isRunning() {
+    QMutexLocker locker(&jobsMutex);
+    return bWorking;
+}
+
+
+// The results come back with kkChecked() and fitDone(), queued to the
+// receivers thread, prefixed by the name of the output file.
+void
+SpectrumAnalyzer::start(QVector<RunRecord> points, QString sOutputFile) {
+    Job job;
+    job.points      = points;
+    job.sOutputFile = sOutputFile;
+    QMutexLocker locker(&jobsMutex);
+    jobs.enqueue(job);
+    if(bWorking)
+        return;
+    bWorking = true;
+    // The previous thread has (or is about to) return
+    if(pThread) {
+        pThread->wait();
+        delete pThread;
+    }
+    pThread = QThread::create([this]() { processJobs(); });
+    pThread->setObjectName("Spectrum Analysis");
+    pThread->start();
+}
+
+
+void
+SpectrumAnalyzer::processJobs() {
+    forever {
+        jobsMutex.lock();
+        if(jobs.isEmpty()) {
+            bWorking = false;
+            jobsMutex.unlock();
+            return;
+        }
+        Job job = jobs.dequeue();
+        jobsMutex.unlock();
+        QString sName = QFileInfo(job.sOutputFile).fileName() + ": ";
+        QString sSummary;
+        int nFlagged;
+        // The faster first: a bad run can be repeated at once
+        if(checkConsistency(job.points, job.sOutputFile, &sSummary, &nFlagged))
+            emit kkChecked(sName + sSummary, nFlagged);
+        else
+            emit message(sName + sSummary);
+        if(analyze(job.points, job.sOutputFile, &sSummary))
+            emit fitDone(sName + sSummary);
+        else
+            emit message(sName + sSummary);
+    }
+}
+
+
+// Blocking. On error pSummary gets the error message.
+bool
+SpectrumAnalyzer::analyze(QVector<RunRecord> points, QString sOutputFile, QString* pSummary) {
+    QVector<double> frequencies, e1, e2;
+    for(int i=0; i<points.count(); i++) {
+        if(points.at(i).status != 0)
+            continue;
+        frequencies.append(points.at(i).frequency);
+        e1.append(points.at(i).e1);
+        e2.append(points.at(i).e2);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    FitResult result = relaxationFit.fit(frequencies, e1, e2);
+    if(result.nStarts == 0) {
+        if(pSummary) *pSummary = QString("Too few points (%1) for the %2 model")
+                                 .arg(frequencies.count())
+                                 .arg(relaxationFit.modelName());
+        return false;
+    }
+    QString sSummary = QString("%1 fit (%2 ms)\n%3")
+                       .arg(relaxationFit.modelName())
+                       .arg(timer.elapsed())
+                       .arg(RelaxationFit::summary(result));
+    if(pSummary) *pSummary = sSummary;
+    if(sOutputFile.isEmpty())
+        return true;
+    QString sFitFile = siblingFile(sOutputFile, "fit");
+    QString sError;
+    if(!writeFitFile(sFitFile, points, result, &sError)) {
+        if(pSummary) *pSummary = QString("%1\n%2").arg(sFitFile, sError);
+        return false;
+    }
+    return true;
+}
+
+
+// Blocking. pnFlagged gets the number of the inconsistent points.
+// On error pSummary gets the error message.
+bool
+SpectrumAnalyzer::checkConsistency(QVector<RunRecord> points, QString sOutputFile,
+                                   QString* pSummary, int* pnFlagged)
+{
+    QVector<double> frequencies, e1, e2;
+    for(int i=0; i<points.count(); i++) {
+        if(points.at(i).status != 0)
+            continue;
+        frequencies.append(points.at(i).frequency);
+        e1.append(points.at(i).e1);
+        e2.append(points.at(i).e2);
+    }
+    KramersKronigResult result = kramersKronig.check(frequencies, e1, e2);
+    if(result.residuals.isEmpty()) {
+        if(pSummary) *pSummary = QString("Too few points (%1) for the Kramers-Kronig check")
+                                 .arg(frequencies.count());
+        return false;
+    }
+    if(pnFlagged) *pnFlagged = result.flagged.count();
+    QString sSummary = QString("Kramers-Kronig: max residual %1% (DC sigma=%2 S/m removed)")
+                       .arg(100.0*result.maxResidual, 0, 'f', 1)
+                       .arg(result.sigma, 0, 'g', 3);
+    if(result.flagged.isEmpty())
+        sSummary += " - consistent";
+    else {
+        QStringList flagged;
+        for(int i=0; i<result.flagged.count(); i++)
+            flagged.append(QString::number(result.frequencies.at(result.flagged.at(i)), 'g', 4));
+        sSummary += QString(" - %1 inconsistent points at f[Hz]= %2")
+                    .arg(result.flagged.count())
+                    .arg(flagged.join(' '));
+    }
+    if(pSummary) *pSummary = sSummary;
+    if(sOutputFile.isEmpty())
+        return true;
+    QString sKkFile = siblingFile(sOutputFile, "kk");
+    QString sError;
+    if(!writeKkFile(sKkFile, result, &sError)) {
+        if(pSummary) *pSummary = QString("%1\n%2").arg(sKkFile, sError);
+        return false;
+    }
+    return true;
+}
+
+
+// i.e. /data/sample.kk for /data/sample.txt
+QString
+SpectrumAnalyzer::siblingFile(QString sOutputFile, QString sExtension) {
+    QFileInfo outputInfo(sOutputFile);
+    return outputInfo.absolutePath() + "/" + outputInfo.completeBaseName() + "." + sExtension;
+}
+
+
+// The transformed E' and E", the relative residual and a
+// flag (1) for the inconsistent points.
+bool
+SpectrumAnalyzer::writeKkFile(QString sFileName, const KramersKronigResult& result,
+                              QString* pErrorString)
+{
+    QFile kkFile(sFileName);
+    if(!kkFile.open(QIODevice::WriteOnly|QIODevice::Text)) {
+        if(pErrorString) *pErrorString = kkFile.errorString();
+        return false;
+    }
+    QTextStream stream(&kkFile);
+    stream << QString("# Offset (Einf + missing band) = %1\n").arg(result.offset, 0, 'g', 6);
+    stream << QString("# DC conductivity added to E2kk = %1 S/m\n").arg(result.sigma, 0, 'g', 6);
+    stream << QString("%1 %2 %3 %4 %5 %6 %7\n")
+              .arg("#Frequency[Hz]", 12)
+              .arg("E1r", 12)
+              .arg("E2r", 12)
+              .arg("E1kk", 12)
+              .arg("E2kk", 12)
+              .arg("Residual", 12)
+              .arg("Flag", 4);
+    for(int i=0; i<result.frequencies.count(); i++) {
+        stream << QString("%1 %2 %3 %4 %5 %6 %7\n")
+                  .arg(result.frequencies.at(i), 12, 'g', 6)
+                  .arg(result.e1.at(i), 12, 'g', 6)
+                  .arg(result.e2.at(i), 12, 'g', 6)
+                  .arg(result.e1Kk.at(i), 12, 'g', 6)
+                  .arg(result.e2Kk.at(i), 12, 'g', 6)
+                  .arg(result.residuals.at(i), 12, 'g', 4)
+                  .arg(result.flagged.contains(i) ? 1 : 0, 4);
+    }
+    stream.flush();
+    if(stream.status() != QTextStream::Ok) {
+        if(pErrorString) *pErrorString = kkFile.errorString();
+        return false;
+    }
+    return true;
+}
+
+
+// The fitted parameters, as comments, then the fitted
+// E' and E" at the measured frequencies.
+bool
+SpectrumAnalyzer::writeFitFile(QString sFileName, const QVector<RunRecord>& points,
+                               const FitResult& result, QString* pErrorString)
+{
+    QFile fitFile(sFileName);
+    if(!fitFile.open(QIODevice::WriteOnly|QIODevice::Text)) {
+        if(pErrorString) *pErrorString = fitFile.errorString();
+        return false;
+    }
+    QTextStream stream(&fitFile);
+    QStringList lines = QString("%1\n%2")
+                        .arg(relaxationFit.modelName())
+                        .arg(RelaxationFit::summary(result))
+                        .split("\n");
+    for(int i=0; i<lines.count(); i++)
+        stream << "# " << lines.at(i) << "\n";
+    stream << QString("%1 %2 %3 %4 %5\n")
+              .arg("#Frequency[Hz]", 12)
+              .arg("E1r", 12)
+              .arg("E2r", 12)
+              .arg("E1fit", 12)
+              .arg("E2fit", 12);
+    for(int i=0; i<points.count(); i++) {
+        const RunRecord& point = points.at(i);
+        if(point.status != 0)
+            continue;
+        std::complex<double> value = RelaxationFit::evaluate(result, point.frequency);
+        stream << QString("%1 %2 %3 %4 %5\n")
+                  .arg(point.frequency, 12, 'g', 6)
+                  .arg(point.e1, 12, 'g', 6)
+                  .arg(point.e2, 12, 'g', 6)
+                  .arg(value.real(), 12, 'g', 6)
+                  .arg(-value.imag(), 12, 'g', 6);
+    }
+    stream.flush();
+    if(stream.status() != QTextStream::Ok) {
+        if(pErrorString) *pErrorString = fitFile.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QQueue>
+#include <QVector>
+#include <QString>
+
+#include "runfile.h"
+#include "relaxationfit.h"
+#include "kramerskronig.h"
+
+
+// The analysis of a completed sweep, made by its own thread so that a
+// new measure can start immediately: the Kramers-Kronig consistency of
+// the spectrum is checked first (.kk file), then the relaxation model
+// is fitted to it and written, with the fitted curves, to a .fit file.
+// Both files are written alongside the output file. The sweeps completed
+// while a spectrum is being analyzed (i.e. by other meters) are queued.
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SpectrumAnalyzer(QObject *parent = nullptr);
+    virtual ~SpectrumAnalyzer();
+
+public:
+    bool setModel(QString sModel, QString* pErrorString);
+    void setStarts(int nStarts);
+    void setKkThreshold(double threshold);
+    void start(QVector<RunRecord> points, QString sOutputFile);
+    bool isRunning();
+    bool analyze(QVector<RunRecord> points, QString sOutputFile, QString* pSummary);
+    bool checkConsistency(QVector<RunRecord> points, QString sOutputFile,
+                          QString* pSummary, int* pnFlagged);
+
+signals:
+    void fitDone(QString sSummary);
+    void kkChecked(QString sSummary, int nFlagged);
+    void message(QString sMessage);
+
+protected:
+    bool writeFitFile(QString sFileName, const QVector<RunRecord>& points,
+                      const FitResult& result, QString* pErrorString);
+    bool writeKkFile(QString sFileName, const KramersKronigResult& result,
+                     QString* pErrorString);
+    QString siblingFile(QString sOutputFile, QString sExtension);
+    void    processJobs();
+
+protected:
+    struct Job {
+        QVector<RunRecord> points;
+        QString            sOutputFile;
+    };
+
+private:
+    RelaxationFit relaxationFit;
+    KramersKronig kramersKronig;
+    QThread*      pThread;
+    QQueue<Job>   jobs;
+    QMutex        jobsMutex;
+    bool          bWorking; // The thread is processing the jobs
+};
@@ -0,0 +1,622 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "sweep.h"
+
+#include <QSettings>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QStringList>
+#include <algorithm>
+
+
+Sweep::Sweep(Hp4284a* pMeter, QObject *parent)
+    : QObject(parent)
+    , pHp4284a(pMeter)
+    , sJournalKey("RunJournal")
+    , e0(8.854e-12)
+    , capacitance0(1.0)
+    , listDelay(0.0)
+    , nListPoints(0)
+    , bRunning(false)
+{
+    qRegisterMetaType<QVector<RunRecord>>("QVector<RunRecord>");
+    config = defaultConfig();
+    QSettings settings;
+    // Data are written by their own threads
+    pOutputWriter = new DataWriter(this);
+    pOutputWriter->setFlushPolicy(settings.value("dataWriterFlushBytes", 64*1024).toInt(),
+                                  settings.value("dataWriterFlushMs", 1000).toInt());
+    pRunWriter = new DataWriter(this);
+    pRunWriter->setFlushPolicy(settings.value("dataWriterFlushBytes", 64*1024).toInt(),
+                               settings.value("dataWriterFlushMs", 1000).toInt());
+    connect(pOutputWriter, SIGNAL(writeError(QString)),
+            this, SIGNAL(writeError(QString)));
+    connect(pRunWriter, SIGNAL(writeError(QString)),
+            this, SIGNAL(writeError(QString)));
+    connect(pHp4284a, SIGNAL(measurementComplete(QVector<Hp4284aResult>)),
+            this, SLOT(onNew4284Measure(QVector<Hp4284aResult>)));
+    connect(pHp4284a, SIGNAL(mustExit()),
+            this, SLOT(onInstrumentError()));
+}
+
+
+// Waits for the pending data to be written
+Sweep::~Sweep() {
+    delete pOutputWriter;
+    delete pRunWriter;
+}
+
+
+// The settings group of the journal: each meter must have its own.
+void
+Sweep::setJournalKey(QString sKey) {
+    sJournalKey = sKey;
+}
+
+
+bool
+Sweep::isRunning() const {
+    return bRunning;
+}
+
+
+bool
+Sweep::isAdaptive() {
+    return frequencyPlan.isAdaptive();
+}
+
+
+int
+Sweep::measuredCount() {
+    return frequencyPlan.measuredCount();
+}
+
+
+int
+Sweep::pendingCount() {
+    return frequencyPlan.pendingCount();
+}
+
+
+const SweepConfig&
+Sweep::currentConfig() const {
+    return config;
+}
+
+
+// The empty capacitor (F) of the current (or last) measure
+double
+Sweep::c0() const {
+    return capacitance0;
+}
+
+
+// The points measured by the current (or last) measure
+QVector<RunRecord>
+Sweep::points() const {
+    return measuredPoints;
+}
+
+
+SweepConfig
+Sweep::defaultConfig() {
+    SweepConfig defaults;
+    defaults.area             = 1.0;
+    defaults.thickness        = 1.0;
+    defaults.testVoltage      = 2.0;
+    defaults.averages         = 0;
+    defaults.settlingPeriods  = 5.0;
+    defaults.bOpenCorrection  = false;
+    defaults.bShortCorrection = false;
+    defaults.bBinaryTransfer  = false;
+    defaults.planMode         = FrequencyPlan::LOG_GRID;
+    defaults.fMin             = 20.0;
+    defaults.fMax             = 1.0e6;
+    defaults.pointsPerDecade  = 10;
+    defaults.extraPoints      = 30;
+    defaults.threshold        = 0.15;
+    return defaults;
+}
+
+
+bool
+Sweep::start(const SweepConfig& newConfig, QString* pErrorString) {
+    if(bRunning) {
+        if(pErrorString) *pErrorString = QString("A measure is already running");
+        return false;
+    }
+    if(!(newConfig.settlingPeriods >= 0.0 && newConfig.settlingPeriods <= 1000.0)) {
+        if(pErrorString) *pErrorString = QString("Settling periods out of range [0 - 1000]");
+        return false;
+    }
+    QString sError;
+    if(!derived.select(newConfig.derivedQuantities, &sError)) {
+        if(pErrorString) *pErrorString = sError;
+        return false;
+    }
+    config = newConfig;
+    capacitance0 = (e0*config.area)/config.thickness;
+    capacitance0 = capacitance0 * 1.0e-3;
+
+    // Prepare the measure frequencies
+    QVector<double> initialFrequencies;
+    if(config.planMode == FrequencyPlan::FILE_LIST)
+        initialFrequencies = FrequencyPlan::loadFile(config.sFrequencyFile, &sError);
+    else
+        initialFrequencies = FrequencyPlan::logGrid(config.fMin,
+                                                    config.fMax,
+                                                    config.pointsPerDecade);
+    if(initialFrequencies.isEmpty()) {
+        if(pErrorString) *pErrorString = QString("No Frequencies to Measure %1").arg(sError);
+        return false;
+    }
+    frequencyPlan.start(initialFrequencies,
+                        config.planMode == FrequencyPlan::ADAPTIVE,
+                        config.extraPoints,
+                        config.threshold);
+    if(!openFiles(false, pErrorString))
+        return false;
+    measuredPoints.clear();
+    writeHeader();
+    saveJournal(initialFrequencies);
+
+    bRunning = true;
+    emit started();
+    startInstrument();
+    measureNextList();
+    return true;
+}
+
+
+// Rebuilds the frequency plan from the points saved in the run file,
+// rewrites the text file from them and continues the measure from the
+// first frequency not yet measured. The points already measured are
+// emitted (all together) by newPoints().
+bool
+Sweep::resume(QString* pErrorString) {
+    if(bRunning) {
+        if(pErrorString) *pErrorString = QString("A measure is already running");
+        return false;
+    }
+    QSettings settings;
+    settings.beginGroup(sJournalKey);
+    sRunFileName       = settings.value("RunFile", QString()).toString();
+    config.sOutputFile = settings.value("OutputFile", QString()).toString();
+    QStringList frequencies = settings.value("Frequencies", QStringList()).toStringList();
+    config.extraPoints = settings.value("ExtraPoints", 0).toInt();
+    config.threshold   = settings.value("Threshold", 0.1).toDouble();
+    config.averages    = settings.value("Averages", 0).toInt();
+    config.derivedQuantities = settings.value("Derived", QStringList()).toStringList();
+    settings.endGroup();
+
+    QString sError;
+    if(!derived.select(config.derivedQuantities, &sError)) {
+        clearJournal();
+        if(pErrorString) *pErrorString = sError;
+        return false;
+    }
+    RunFile runFile;
+    if(frequencies.isEmpty() || !runFile.open(sRunFileName, &sError)) {
+        clearJournal();
+        if(pErrorString) *pErrorString = QString("%1\n%2").arg(sRunFileName, sError);
+        return false;
+    }
+    const RunFileHeader& header = runFile.header();
+    capacitance0            = header.c0;
+    config.area             = header.area;
+    config.thickness        = header.thickness;
+    config.sSampleInfo      = runFile.sampleInfo();
+    config.testVoltage      = header.testVoltage;
+    config.settlingPeriods  = header.settlingPeriods;
+    config.bOpenCorrection  = (header.flags & RunFile::OPEN_CORRECTION) != 0;
+    config.bShortCorrection = (header.flags & RunFile::SHORT_CORRECTION) != 0;
+    config.bBinaryTransfer  = (header.flags & RunFile::BINARY_TRANSFER) != 0;
+    config.planMode         = header.frequencyPlan;
+    qint64 validSize = qint64(header.headerSize) + qint64(runFile.count())*header.recordSize;
+
+    QVector<double> initialFrequencies;
+    for(int i=0; i<frequencies.count(); i++)
+        initialFrequencies.append(frequencies.at(i).toDouble());
+    frequencyPlan.start(initialFrequencies,
+                        config.planMode == FrequencyPlan::ADAPTIVE,
+                        config.extraPoints,
+                        config.threshold);
+    QVector<RunRecord> points;
+    for(int i=0; i<runFile.count(); i++) {
+        const RunRecord& point = runFile.record(i);
+        if(point.status != 0) // Will be measured again
+            continue;
+        frequencyPlan.resumeResult(point.frequency, point.e2, point.d);
+        points.append(point);
+    }
+    // The text file could end with a partial line: it is rewritten from
+    // the run file, whose partial record (if any) is dropped.
+    bool bOk = runFile.exportText(config.sOutputFile, derived, &sError);
+    runFile.close();
+    if(bOk && !QFile::resize(sRunFileName, validSize)) {
+        sError = QString("Unable to truncate %1").arg(sRunFileName);
+        bOk = false;
+    }
+    if(!bOk) {
+        if(pErrorString) *pErrorString = sError;
+        return false;
+    }
+    if(!openFiles(true, pErrorString))
+        return false;
+    measuredPoints = points;
+
+    bRunning = true;
+    emit started();
+    emit newPoints(points);
+    // The measure was interrupted just before its end
+    if(!frequencyPlan.hasPending() && !frequencyPlan.refine()) {
+        finish(true);
+        return true;
+    }
+    startInstrument();
+    measureNextList();
+    emit message(QString("Measure Resumed after %1 Points")
+                 .arg(frequencyPlan.measuredCount()));
+    return true;
+}
+
+
+// Stops the measure. The data already measured are kept
+// but the measure can no more be resumed.
+void
+Sweep::stop() {
+    if(!bRunning)
+        return;
+    halt();
+    clearJournal();
+    emit stopped();
+}
+
+
+void
+Sweep::halt() {
+    bRunning = false;
+    pHp4284a->clearQueue();
+    Hp4284a* pMeter = pHp4284a;
+    pHp4284a->post([pMeter]() {
+        pMeter->disableQuery();
+    });
+    closeFiles();
+}
+
+
+void
+Sweep::finish(bool bCompleted) {
+    halt();
+    clearJournal();
+    if(bCompleted)
+        writeDerivedFile();
+    emit finished(bCompleted);
+}
+
+
+// The quantities that need the whole spectrum (i.e. the derivative
+// loss) are computed, all together, when the sweep ends and written,
+// with the other selected ones, to a .der file sorted by frequency.
+void
+Sweep::writeDerivedFile() {
+    QVector<int> quantities = derived.selected();
+    if(derived.pointwiseCount() == quantities.count())
+        return;
+    QVector<RunRecord> spectrum = measuredPoints;
+    std::sort(spectrum.begin(), spectrum.end(), [](const RunRecord& a, const RunRecord& b) {
+        return a.frequency < b.frequency;
+    });
+    QVector<QVector<double>> columns;
+    QString sHeader = QString("%1 %2").arg("#Frequency[Hz]", 12).arg("E2r", 12);
+    for(int i=0; i<quantities.count(); i++) {
+        columns.append(DerivedQuantities::batch(quantities.at(i), spectrum, capacitance0));
+        sHeader += QString(" %1").arg(DerivedQuantities::label(quantities.at(i)), 12);
+    }
+    QFileInfo outputInfo(config.sOutputFile);
+    QString sFileName = outputInfo.absolutePath() + "/" + outputInfo.completeBaseName() + ".der";
+    QString sError;
+    if(!pOutputWriter->open(sFileName, QIODevice::Text|QIODevice::WriteOnly, &sError)) {
+        emit writeError(QString("%1\n%2").arg(sFileName, sError));
+        return;
+    }
+    pOutputWriter->writeData(sHeader.toLocal8Bit() + "\n");
+    double values[2+DerivedQuantities::N_QUANTITIES];
+    for(int i=0; i<spectrum.count(); i++) {
+        values[0] = spectrum.at(i).frequency;
+        values[1] = spectrum.at(i).e2;
+        for(int j=0; j<columns.count(); j++)
+            values[2+j] = columns.at(j).at(i);
+        pOutputWriter->writeValues(values, 2+columns.count());
+    }
+    pOutputWriter->close();
+}
+
+
+// Any unrecoverable instrument error aborts the measure,
+// that can then be resumed. It can be signaled more than
+// once for the same failure.
+void
+Sweep::onInstrumentError() {
+    if(!bRunning)
+        return;
+    halt();
+    emit finished(false);
+}
+
+
+bool
+Sweep::openFiles(bool bAppend, QString* pErrorString) {
+    QString sError;
+    QIODevice::OpenMode mode = QIODevice::WriteOnly;
+    if(bAppend)
+        mode |= QIODevice::Append;
+    if(!pOutputWriter->open(config.sOutputFile, QIODevice::Text|mode, &sError)) {
+        if(pErrorString) *pErrorString = QString("%1\n%2").arg(config.sOutputFile, sError);
+        return false;
+    }
+    // The same data, in binary form, go to a .run file
+    QFileInfo outputInfo(config.sOutputFile);
+    sRunFileName = outputInfo.absolutePath() + "/" + outputInfo.completeBaseName() + ".run";
+    if(!pRunWriter->open(sRunFileName, mode, &sError)) {
+        pOutputWriter->close();
+        if(pErrorString) *pErrorString = QString("%1\n%2").arg(sRunFileName, sError);
+        return false;
+    }
+    return true;
+}
+
+
+// Flushed and fsync()-ed by the writer threads
+void
+Sweep::closeFiles() {
+    pOutputWriter->close();
+    pRunWriter->close();
+}
+
+
+void
+Sweep::writeHeader() { // Write the File header
+    // To cope with the GnuPlot way to handle the comment lines
+    // we need a # as a first chraracter in each comment row.
+    pOutputWriter->writeData(QString("%1 %2 %3 %4 %5 %6%7\n")
+                           .arg("#Frequency[Hz]", 12)
+                           .arg("E1r", 12)
+                           .arg("E2r", 12)
+                           .arg("TanD", 12)
+                           .arg("Cp", 12)
+                           .arg("Settle[s]", 12)
+                           .arg(derived.header())
+                           .toLocal8Bit());
+    pOutputWriter->writeData(QString("#Area = %1mm^2 Thickness=%2mm C0=%3 F\n")
+                       .arg(config.area, 12)
+                       .arg(config.thickness, 12)
+                       .arg(capacitance0, 12)
+                       .toLocal8Bit());
+    QStringList HeaderLines = config.sSampleInfo.split("\n");
+    for(int i=0; i<HeaderLines.count(); i++) {
+        pOutputWriter->writeData("# " + HeaderLines.at(i).toLocal8Bit() + "\n");
+    }
+
+    RunFileHeader header;
+    header.area            = config.area;
+    header.thickness       = config.thickness;
+    header.c0              = capacitance0;
+    header.testVoltage     = config.testVoltage;
+    header.settlingPeriods = config.settlingPeriods;
+    header.startTime       = QDateTime::currentMSecsSinceEpoch();
+    header.mode            = Hp4284a::CPD;
+    header.flags           = 0;
+    if(config.bOpenCorrection)  header.flags |= RunFile::OPEN_CORRECTION;
+    if(config.bShortCorrection) header.flags |= RunFile::SHORT_CORRECTION;
+    if(config.bBinaryTransfer)  header.flags |= RunFile::BINARY_TRANSFER;
+    header.frequencyPlan   = config.planMode;
+    pRunWriter->writeData(RunFile::makeHeader(header, config.sSampleInfo));
+}
+
+
+// The run file holds the configuration and every completed point.
+// What is needed to rebuild the frequency plan is saved in the settings
+// until the measure ends, so that a run interrupted by a crash (or by an
+// instrument error) can be resumed.
+void
+Sweep::saveJournal(QVector<double> initialFrequencies) {
+    QStringList frequencies;
+    for(int i=0; i<initialFrequencies.count(); i++)
+        frequencies.append(QString::number(initialFrequencies.at(i), 'g', 17));
+    QSettings settings;
+    settings.beginGroup(sJournalKey);
+    settings.setValue("RunFile",     sRunFileName);
+    settings.setValue("OutputFile",  config.sOutputFile);
+    settings.setValue("Frequencies", frequencies);
+    settings.setValue("ExtraPoints", config.extraPoints);
+    settings.setValue("Threshold",   config.threshold);
+    settings.setValue("Averages",    config.averages);
+    settings.setValue("Derived",     config.derivedQuantities);
+    settings.endGroup();
+    settings.sync();
+}
+
+
+void
+Sweep::clearJournal() {
+    QSettings settings;
+    settings.remove(sJournalKey);
+    settings.sync();
+}
+
+
+// The run file of the measure left unfinished
+// by a previous session (if any).
+QString
+Sweep::interruptedRun() {
+    QSettings settings;
+    QString sFileName = settings.value(sJournalKey + "/RunFile", QString()).toString();
+    if(sFileName.isEmpty())
+        return QString();
+    if(!QFileInfo::exists(sFileName)) {
+        clearJournal();
+        return QString();
+    }
+    return sFileName;
+}
+
+
+// The instrument is configured by its I/O thread:
+// errors will be notified by the mustExit() signal
+void
+Sweep::startInstrument() {
+    emit message("Initializing 4284a...");
+    Hp4284a* pMeter = pHp4284a;
+    double dVoltage = config.testVoltage;
+    int nAverages   = config.averages;
+    bool bOpenCorr  = config.bOpenCorrection;
+    bool bShortCorr = config.bShortCorrection;
+    bool bBinary    = config.bBinaryTransfer;
+    pHp4284a->post([pMeter, dVoltage, nAverages, bOpenCorr, bShortCorr, bBinary]() {
+        if(pMeter->init())
+            return;
+        pMeter->setBinaryTransfer(bBinary);
+        pMeter->setMode(Hp4284a::CPD);
+        pMeter->setAmplitude(dVoltage);
+        if(nAverages > 0)
+            pMeter->setAverages(nAverages);
+        pMeter->setOpenCorrection(bOpenCorr);
+        pMeter->setShortCorrection(bShortCorr);
+        pMeter->enableListSweep();
+    });
+}
+
+
+// The time to wait, after a frequency change, before the measure:
+// a fixed number of periods of the test signal, rounded to the 1ms
+// resolution of the trigger delay. At high frequency it is negligible.
+// The aperture and the averages (APER, changed by setAverages()) are
+// not part of it: they set how long the instrument integrates after
+// the delay, not how long the transient of the sample takes to decay.
+double
+Sweep::settlingDelay(double f) {
+    double delay = config.settlingPeriods/f;
+    if(delay > 60.0)
+        delay = 60.0;
+    return qRound(delay*1.0e3)*1.0e-3;
+}
+
+
+// Queue the list sweep of the next (up to MAX_LIST_POINTS) frequencies.
+// The values will come back, all together, with measurementComplete()
+// The trigger delay, applied by the instrument before each point, is
+// the settling time of the lowest (first) frequency of the list: the
+// list is cut short when the next frequencies would wait much longer
+// than they need.
+void
+Sweep::measureNextList() {
+    QVector<double> nextFrequencies = frequencyPlan.nextFrequencies(Hp4284a::MAX_LIST_POINTS);
+    listDelay = settlingDelay(nextFrequencies.first());
+    nListPoints = 1;
+    if(listDelay > 0.05) {
+        while((nListPoints < nextFrequencies.count()) &&
+              (settlingDelay(nextFrequencies.at(nListPoints)) > 0.5*listDelay))
+            nListPoints++;
+    }
+    else {
+        nListPoints = nextFrequencies.count();
+    }
+    listFrequencies = frequencyPlan.takeNext(nListPoints);
+    Hp4284a* pMeter = pHp4284a;
+    QVector<double> frequencies = listFrequencies;
+    double dDelay = listDelay;
+    pHp4284a->post([pMeter, frequencies, dDelay]() {
+        if(!pMeter->setTriggerDelay(dDelay)) {
+            emit pMeter->aMessage(QString("Invalid trigger delay: %1s").arg(dDelay));
+            emit pMeter->mustExit();
+            return;
+        }
+        pMeter->setListFrequencies(frequencies);
+        // One message (and one error query) for both the settings
+        if(!pMeter->flushCommands())
+            return;
+        pMeter->queryListValues();
+    });
+    emit message(QString("Waiting data at f=%1-%2Hz")
+                 .arg(listFrequencies.first())
+                 .arg(listFrequencies.last()));
+}
+
+
+void
+Sweep::onNew4284Measure(QVector<Hp4284aResult> results) {
+    if(!bRunning) // The measure was stopped while these values were in flight
+        return;
+    // The list frequencies are already out of the plan: a missing value
+    // would be a hole in a "completed" spectrum. The measure is aborted
+    // instead and can be resumed from the journal.
+    if(results.count() != nListPoints) {
+        emit message(QString("%1 values received for %2 frequencies")
+                     .arg(results.count()).arg(nListPoints));
+        onInstrumentError();
+        return;
+    }
+    int nPoints = nListPoints;
+    qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
+    QVector<RunRecord> points;
+    points.reserve(nPoints);
+    for(int i=0; i<nPoints; i++) {
+        const Hp4284aResult& result = results.at(i);
+        RunRecord record;
+        record.frequency = listFrequencies.at(i);
+        record.cp        = result.primary;
+        record.d         = result.secondary;
+        record.e1        = result.primary/capacitance0;
+        record.e2        = result.secondary*record.e1;
+        record.settle    = listDelay;
+        record.timestamp = timestamp;
+        record.status    = result.status;
+        record.reserved  = 0;
+        // The run file keeps the failed points too
+        pRunWriter->writeData(RunFile::makeRecord(record));
+        if(result.status != 0)
+            continue;
+        frequencyPlan.addResult(record.frequency, record.e2, record.d);
+        // Formatted and written by the writer thread
+        double values[6+DerivedQuantities::N_QUANTITIES] = {record.frequency, record.e1, record.e2,
+                                                            record.d, record.cp, listDelay};
+        int nValues = 6 + derived.compute(record, capacitance0, values+6);
+        pOutputWriter->writeValues(values, nValues);
+        points.append(record);
+    }
+    // The completed points must survive a crash
+    pRunWriter->sync();
+    measuredPoints += points;
+    emit newPoints(points);
+    if(!bRunning) // Stopped by a receiver of newPoints()
+        return;
+    // In adaptive mode new frequencies are added when the
+    // previous ones have all been measured
+    if(!frequencyPlan.hasPending() && !frequencyPlan.refine()) {
+        finish(true);
+        return;
+    }
+    measureNextList();
+}
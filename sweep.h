@@ -0,0 +1,129 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "hp4284a.h"
+#include "frequencyplan.h"
+#include "datawriter.h"
+#include "runfile.h"
+#include "derivedquantities.h"
+
+
+// The parameters of a measure, as chosen in the ConfigureDlg
+// or given on the command line.
+struct SweepConfig {
+    double  area;             // mm^2
+    double  thickness;        // mm
+    QString sSampleInfo;
+    double  testVoltage;      // V
+    int     averages;         // 0 leaves the instrument setting
+    double  settlingPeriods;  // Of the test signal before each point
+    bool    bOpenCorrection;
+    bool    bShortCorrection;
+    bool    bBinaryTransfer;
+    int     planMode;         // FrequencyPlan::LOG_GRID, FILE_LIST or ADAPTIVE
+    double  fMin;             // Hz
+    double  fMax;             // Hz
+    int     pointsPerDecade;
+    QString sFrequencyFile;
+    int     extraPoints;
+    double  threshold;
+    QString sOutputFile;      // The .run file is written alongside
+    QStringList derivedQuantities; // Added to the output columns (see DerivedQuantities)
+};
+
+
+// A frequency sweep with the HP4284A: it drives the instrument through
+// the FrequencyPlan and writes the text and the run files, without any
+// user interface. The run file is the journal of the measure: what is
+// needed to resume it after a crash is kept in the settings (under the
+// journal key) until the sweep ends.
+class Sweep : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Sweep(Hp4284a* pMeter, QObject *parent = nullptr);
+    virtual ~Sweep();
+
+public:
+    static SweepConfig defaultConfig();
+    bool    start(const SweepConfig& newConfig, QString* pErrorString);
+    bool    resume(QString* pErrorString);
+    void    stop();
+    bool    isRunning() const;
+    bool    isAdaptive();
+    int     measuredCount();
+    int     pendingCount();
+    const SweepConfig& currentConfig() const;
+    double  c0() const;
+    QVector<RunRecord> points() const;
+    QString interruptedRun();
+    void    clearJournal();
+    void    setJournalKey(QString sKey);
+
+signals:
+    void started();
+    void newPoints(QVector<RunRecord> points);
+    void finished(bool bCompleted);
+    void stopped();
+    void message(QString sMessage);
+    void writeError(QString sError);
+
+protected slots:
+    void onNew4284Measure(QVector<Hp4284aResult> results);
+    void onInstrumentError();
+
+protected:
+    bool   openFiles(bool bAppend, QString* pErrorString);
+    void   closeFiles();
+    void   writeHeader();
+    void   writeDerivedFile();
+    void   saveJournal(QVector<double> initialFrequencies);
+    void   startInstrument();
+    void   measureNextList();
+    double settlingDelay(double f);
+    void   halt();
+    void   finish(bool bCompleted);
+
+private:
+    Hp4284a*        pHp4284a;
+    DataWriter*     pOutputWriter;
+    DataWriter*     pRunWriter;
+    SweepConfig     config;
+    FrequencyPlan   frequencyPlan;
+    DerivedQuantities derived;
+    QVector<double> listFrequencies;
+    QVector<RunRecord> measuredPoints;
+    QString         sRunFileName;
+    QString         sJournalKey;
+    const double    e0;
+    double          capacitance0;
+    double          listDelay;
+    int             nListPoints;
+    bool            bRunning;
+};
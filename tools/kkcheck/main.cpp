@@ -0,0 +1,76 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Checks KramersKronig against the Havriliak-Negami relaxation of the
+// Hp4284aSimulator (with its default parameters) plus an optional DC
+// conductivity: the spectrum is consistent by construction, so the
+// residuals measure the error of the transform alone and the estimated
+// conductivity should match the given one. Exits with 1 if any point
+// is flagged.
+//     kkcheck [points per decade] [sigma (S/m)]
+
+#include "kramerskronig.h"
+
+#include <QVector>
+#include <complex>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static const double EPS_INF   = 3.0;
+static const double DELTA_EPS = 10.0;
+static const double TAU       = 1.0e-4;
+static const double ALPHA     = 0.8;
+static const double BETA      = 0.6;
+static const double E0        = 8.854e-12;
+
+
+int
+main(int argc, char *argv[]) {
+    int pointsPerDecade = (argc > 1) ? atoi(argv[1]) : 10;
+    double sigma = (argc > 2) ? atof(argv[2]) : 0.0;
+    if(pointsPerDecade < 1 || sigma < 0.0) {
+        fprintf(stderr, "Usage: kkcheck [points per decade] [sigma (S/m)]\n");
+        return 2;
+    }
+    // The HP 4284A range
+    QVector<double> frequencies, e1, e2;
+    int nPoints = int(round(log10(1.0e6/20.0)*pointsPerDecade)) + 1;
+    for(int i=0; i<nPoints; i++) {
+        double f = 20.0*pow(10.0, double(i)/pointsPerDecade);
+        std::complex<double> iwt(0.0, 2.0*M_PI*f*TAU);
+        std::complex<double> eps = EPS_INF + DELTA_EPS/pow(1.0 + pow(iwt, ALPHA), BETA);
+        frequencies.append(f);
+        e1.append(eps.real());
+        e2.append(-eps.imag() + sigma/(E0*2.0*M_PI*f));
+    }
+    KramersKronig kramersKronig;
+    KramersKronigResult result = kramersKronig.check(frequencies, e1, e2);
+    printf("%d points: offset=%g (Einf=%g) sigma=%g (%g) max residual=%.3f%% flagged=%d\n",
+           int(result.frequencies.count()),
+           result.offset, EPS_INF,
+           result.sigma, sigma,
+           100.0*result.maxResidual,
+           int(result.flagged.count()));
+    return result.flagged.isEmpty() ? 0 : 1;
+}
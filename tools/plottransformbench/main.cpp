@@ -0,0 +1,99 @@
+// MIT License
+
+// Copyright (c) 2020 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Times PlotTransform::toScreen (SSE2 where available) against
+// PlotTransform::toScreenScalar on the same points, on a logarithmic
+// x axis (as a frequency axis) and a linear y axis, and reports the
+// largest difference between the two results (in pixels).
+//     plottransformbench [number of points] [repetitions]
+
+#include "plottransform.h"
+
+#include <QElapsedTimer>
+#include <QPointF>
+#include <QVector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static double
+bestTime(const QVector<double>& x, const QVector<double>& y,
+         const PlotTransform::Axis& xAxis, const PlotTransform::Axis& yAxis,
+         QVector<QPointF>& out, int nRepetitions, bool bScalar)
+{
+    QElapsedTimer timer;
+    qint64 best = -1;
+    for(int i=0; i<nRepetitions; i++) {
+        timer.start();
+        if(bScalar)
+            PlotTransform::toScreenScalar(x.constData(), y.constData(), x.count(),
+                                          xAxis, yAxis, out.data());
+        else
+            PlotTransform::toScreen(x.constData(), y.constData(), x.count(),
+                                    xAxis, yAxis, out.data());
+        qint64 elapsed = timer.nsecsElapsed();
+        if(best < 0 || elapsed < best)
+            best = elapsed;
+    }
+    return double(best)*1.0e-6;
+}
+
+
+int
+main(int argc, char *argv[]) {
+    int nPoints      = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int nRepetitions = (argc > 2) ? atoi(argv[2]) : 10;
+    if(nPoints < 1 || nRepetitions < 1) {
+        fprintf(stderr, "Usage: plottransformbench [number of points] [repetitions]\n");
+        return 2;
+    }
+    // 20Hz - 1MHz on 1000 pixels, -10 - 10 on 600 pixels
+    QVector<double> x(nPoints), y(nPoints);
+    for(int i=0; i<nPoints; i++) {
+        x[i] = 20.0*pow(10.0, log10(1.0e6/20.0)*i/nPoints);
+        y[i] = 10.0*sin(0.001*i);
+    }
+    PlotTransform::Axis xAxis = {true,  log10(20.0), 1000.0/log10(1.0e6/20.0), 0.0};
+    PlotTransform::Axis yAxis = {false, -10.0, -600.0/20.0, 600.0};
+
+    QVector<QPointF> fast(nPoints), scalar(nPoints);
+    double fastTime   = bestTime(x, y, xAxis, yAxis, fast,   nRepetitions, false);
+    double scalarTime = bestTime(x, y, xAxis, yAxis, scalar, nRepetitions, true);
+
+    double maxDifference = 0.0;
+    for(int i=0; i<nPoints; i++) {
+        maxDifference = qMax(maxDifference, qAbs(fast.at(i).x()-scalar.at(i).x()));
+        maxDifference = qMax(maxDifference, qAbs(fast.at(i).y()-scalar.at(i).y()));
+    }
+#if defined(__SSE2__) && !defined(QT_COORD_TYPE)
+    const char* sPath = "SSE2";
+#else
+    const char* sPath = "scalar (no SSE2)";
+#endif
+    printf("%d points, best of %d\n", nPoints, nRepetitions);
+    printf("toScreen (%s): %8.3f ms\n", sPath, fastTime);
+    printf("toScreenScalar:  %8.3f ms\n", scalarTime);
+    printf("speedup: %.2f  max difference: %g pixels\n",
+           fastTime > 0.0 ? scalarTime/fastTime : 0.0, maxDifference);
+    return 0;
+}